@@ -0,0 +1,399 @@
+// Benchmark suite covering the main operations of config on generated
+// configurations of 10 to 10^6 keys: loading (initFile,
+// initFileMapped, initCL with a large argv), key lookups
+// (getParamString, parseParamUInt, parseParamDouble) and list and
+// sequence parsing (listParser, sequenceParser). For each measurement
+// it reports the time and the number of heap allocations per
+// operation, and the peak resident set size of the process during the
+// measurement.
+//
+// The default output is a table. "--csv" and "--json" print the same
+// results in a machine-readable form, along with the compiler and the
+// build options, so that runs can be compared to catch regressions.
+//
+// Usage: config_bench [--csv | --json] [--max-keys N] [--dir D]
+//   --max-keys N  largest configuration (default 1000000)
+//   --dir D       where the generated files are written (default /tmp)
+
+#include "config/config.hpp"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// ---------- allocation counting ----------
+
+namespace {
+  std::atomic<size_t> nbAllocations(0);
+  std::atomic<size_t> nbAllocatedBytes(0);
+}
+
+void* operator new(size_t size) {
+  nbAllocations.fetch_add(1, std::memory_order_relaxed);
+  nbAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  void* p = malloc(size ? size : 1);
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+// Every delete goes through benchFree(): calling free() directly in
+// the operators makes gcc report mismatched new/delete once they are
+// inlined at call sites (-Wmismatched-new-delete).
+namespace {
+  __attribute__((noinline)) void benchFree(void* p) noexcept { free(p); }
+}
+
+void operator delete(void* p) noexcept { benchFree(p); }
+void operator delete[](void* p) noexcept { benchFree(p); }
+void operator delete(void* p, size_t) noexcept { benchFree(p); }
+void operator delete[](void* p, size_t) noexcept { benchFree(p); }
+
+namespace {
+
+  typedef std::chrono::steady_clock bench_clock;
+
+  enum output_format { TABLE, CSV, JSON };
+
+  /// Operations per measurement for the operations that are repeated.
+  const size_t NB_OPERATIONS = 1000000;
+
+  /// Minimum number of keys loaded per measurement of a loader.
+  const size_t MIN_LOADED_KEYS = 200000;
+
+  struct result {
+    string name;
+    size_t nbKeys;
+    size_t nbOps;
+    double ns;
+    size_t allocations;
+    size_t allocatedBytes;
+    long peakRssKb;
+  };
+
+  /**
+   * Resets the peak RSS of the process (Linux 4.0 and later), so that
+   * each measurement reports its own peak.
+   *@return 'false' if the peak cannot be reset.
+   */
+  bool resetPeakRss() {
+    FILE* f = fopen("/proc/self/clear_refs", "w");
+    if(!f) return false;
+    bool ok = fputs("5", f) >= 0;
+    return (fclose(f) == 0) && ok;
+  }
+
+  /// Peak RSS in kB (since the last reset, if resetPeakRss() works).
+  long peakRssKb() {
+    FILE* f = fopen("/proc/self/status", "r");
+    if(f) {
+      char line[256];
+      while(fgets(line, sizeof(line), f)) {
+        if(strncmp(line, "VmHWM:", 6) == 0) {
+          fclose(f);
+          return strtol(line + 6, 0, 10);
+        }
+      }
+      fclose(f);
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+
+  /**
+   * Measures "nbOps" operations performed by "run" (which may perform
+   * them in any number of calls).
+   */
+  class measurement {
+  public:
+    measurement(const string& name, size_t nbKeys, size_t nbOps)
+    {
+      m_result.name = name;
+      m_result.nbKeys = nbKeys;
+      m_result.nbOps = nbOps;
+      resetPeakRss();
+      m_allocations = nbAllocations.load();
+      m_allocatedBytes = nbAllocatedBytes.load();
+      m_start = bench_clock::now();
+    }
+
+    result stop() {
+      m_result.ns = std::chrono::duration<double, std::nano>(bench_clock::now()-m_start).count();
+      m_result.allocations = nbAllocations.load() - m_allocations;
+      m_result.allocatedBytes = nbAllocatedBytes.load() - m_allocatedBytes;
+      m_result.peakRssKb = peakRssKb();
+      return m_result;
+    }
+
+  private:
+    result m_result;
+    size_t m_allocations;
+    size_t m_allocatedBytes;
+    bench_clock::time_point m_start;
+  };
+
+  string keyName(size_t i) {
+    return "component_" + std::to_string(i%97) + ":param_" + std::to_string(i);
+  }
+
+  /// Value of key "i": alternately an integer, a real number, a string, a list.
+  string keyValue(size_t i) {
+    switch(i%4) {
+    case 0: return std::to_string(i);
+    case 1: return std::to_string(i) + ".25";
+    case 2: return "value_" + std::to_string(i);
+    default: return "{" + std::to_string(i) + ", 1, 2, 3}";
+    }
+  }
+
+  string writeConfigFile(const string& dir, size_t nbKeys) {
+    string filepath = dir + "/config_bench_" + std::to_string(getpid()) + "_" +
+      std::to_string(nbKeys) + ".cfg";
+    std::ofstream ofs(filepath.c_str());
+    ofs << "# generated by config_bench\n";
+    for(size_t i=0; i<nbKeys; i++) ofs << keyName(i) << " = " << keyValue(i) << "\n";
+    return filepath;
+  }
+
+  void benchLoading(const string& filepath, size_t nbKeys, vector<result>& results) {
+    size_t nbReps = (MIN_LOADED_KEYS + nbKeys - 1) / nbKeys;
+
+    measurement m("initFile", nbKeys, nbReps * nbKeys);
+    for(size_t r=0; r<nbReps; r++) {
+      config conf;
+      conf.initFile(filepath);
+    }
+    results.push_back(m.stop());
+
+    measurement mapped("initFileMapped", nbKeys, nbReps * nbKeys);
+    for(size_t r=0; r<nbReps; r++) {
+      config conf;
+      conf.initFileMapped(filepath);
+    }
+    results.push_back(mapped.stop());
+
+    // argv[0] is the program name
+    vector<string> args(1, "config_bench");
+    for(size_t i=0; i<nbKeys; i++) args.push_back(keyName(i) + "=" + keyValue(i));
+    vector<char*> argv;
+    for(size_t i=0; i<args.size(); i++) argv.push_back(&args[i][0]);
+    measurement cl("initCL", nbKeys, nbReps * nbKeys);
+    for(size_t r=0; r<nbReps; r++) {
+      config conf;
+      conf.initCL(argv.size(), argv.data());
+    }
+    results.push_back(cl.stop());
+  }
+
+  void benchLookups(const string& filepath, size_t nbKeys, vector<result>& results,
+                    size_t& checksum) {
+    config conf;
+    conf.initFileMapped(filepath);
+    vector<string> keys;
+    for(size_t i=0; i<nbKeys; i++) keys.push_back(keyName(i));
+
+    // random access pattern, on keys of the type expected by each getter
+    std::mt19937 rng(42);
+    vector<const char*> anyKey(NB_OPERATIONS), uintKey(NB_OPERATIONS), doubleKey(NB_OPERATIONS);
+    size_t nbGroups = (nbKeys + 3) / 4;
+    for(size_t i=0; i<NB_OPERATIONS; i++) {
+      size_t group = rng() % nbGroups;
+      anyKey[i] = keys[rng() % nbKeys].c_str();
+      uintKey[i] = keys[4*group].c_str();
+      doubleKey[i] = keys[4*group + 1 < nbKeys ? 4*group + 1 : 4*group].c_str();
+    }
+
+    measurement str("getParamString", nbKeys, NB_OPERATIONS);
+    for(size_t i=0; i<NB_OPERATIONS; i++) checksum += conf.getParamString(anyKey[i]).size();
+    results.push_back(str.stop());
+
+    measurement view("getParamView", nbKeys, NB_OPERATIONS);
+    for(size_t i=0; i<NB_OPERATIONS; i++) checksum += conf.getParamView(anyKey[i]).size();
+    results.push_back(view.stop());
+
+    measurement uintLookup("parseParamUInt", nbKeys, NB_OPERATIONS);
+    for(size_t i=0; i<NB_OPERATIONS; i++) checksum += conf.parseParamUInt(uintKey[i]);
+    results.push_back(uintLookup.stop());
+
+    measurement doubleLookup("parseParamDouble", nbKeys, NB_OPERATIONS);
+    for(size_t i=0; i<NB_OPERATIONS; i++) checksum += conf.parseParamDouble(doubleKey[i]);
+    results.push_back(doubleLookup.stop());
+  }
+
+  /**
+   * Lists and sequences of "nbElements" elements. Each measurement
+   * uses a new config, so that no value is parsed from the cache.
+   */
+  void benchLists(size_t nbElements, vector<result>& results, size_t& checksum) {
+    string list = "{";
+    for(size_t i=0; i<nbElements; i++) {
+      if(i > 0) list += ", ";
+      list += std::to_string(i * 0.000123 - 3.5);
+    }
+    list += "}";
+    string uintSeq = "0:1:" + std::to_string(nbElements - 1);
+    string doubleSeq = "0:0.5:" + std::to_string((nbElements - 1) / 2) +
+      (nbElements % 2 == 0 ? ".5" : "");
+    size_t nbReps = (MIN_LOADED_KEYS + nbElements - 1) / nbElements;
+    vector<config> confs(nbReps);
+    for(size_t r=0; r<nbReps; r++) {
+      confs[r].addConfElem("list", list);
+      confs[r].addConfElem("uint_seq", uintSeq);
+      confs[r].addConfElem("double_seq", doubleSeq);
+    }
+
+    vector<double> doubles;
+    measurement doubleList("listParser(vector<double>)", nbElements, nbReps * nbElements);
+    for(size_t r=0; r<nbReps; r++) {
+      confs[r].listParser("list", doubles);
+      checksum += doubles.size();
+    }
+    results.push_back(doubleList.stop());
+
+    vector<int> ints;
+    measurement intList("listParser(vector<int>)", nbElements, nbReps * nbElements);
+    for(size_t r=0; r<nbReps; r++) {
+      confs[r].listParser("list", ints);
+      checksum += ints.size();
+    }
+    results.push_back(intList.stop());
+
+    vector<double> buffer(nbElements);
+    measurement bufferList("listParser(double*)", nbElements, nbReps * nbElements);
+    for(size_t r=0; r<nbReps; r++) {
+      checksum += confs[r].listParser("list", buffer.data(), buffer.size());
+    }
+    results.push_back(bufferList.stop());
+
+    vector<uint> uints;
+    measurement uintSeqParse("sequenceParser(vector<uint>)", nbElements, nbReps * nbElements);
+    for(size_t r=0; r<nbReps; r++) {
+      confs[r].sequenceParser("uint_seq", uints);
+      checksum += uints.size();
+    }
+    results.push_back(uintSeqParse.stop());
+
+    measurement doubleSeqParse("sequenceParser(vector<double>)", nbElements, nbReps * nbElements);
+    for(size_t r=0; r<nbReps; r++) {
+      confs[r].sequenceParser("double_seq", doubles);
+      checksum += doubles.size();
+    }
+    results.push_back(doubleSeqParse.stop());
+  }
+
+  string compilerName() {
+#if defined(__clang__)
+    return string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    return string("gcc ") + __VERSION__;
+#else
+    return "unknown";
+#endif
+  }
+
+  const char* regexBackend() {
+#ifdef USE_BOOST_REGEX
+    return "boost";
+#else
+    return "std";
+#endif
+  }
+
+  const char* buildType() {
+#ifdef NDEBUG
+    return "release";
+#else
+    return "debug";
+#endif
+  }
+
+  void print(const vector<result>& results, output_format format) {
+    if(format == TABLE) {
+      printf("compiler: %s, regex backend: %s, build: %s\n\n",
+             compilerName().c_str(), regexBackend(), buildType());
+      printf("%-32s %8s %12s %12s %12s %12s\n",
+             "benchmark", "keys", "ns/op", "allocs/op", "bytes/op", "peak RSS kB");
+    }
+    else if(format == CSV) {
+      printf("# compiler=%s regex_backend=%s build=%s\n",
+             compilerName().c_str(), regexBackend(), buildType());
+      printf("benchmark,keys,ops,ns_per_op,allocs_per_op,bytes_per_op,peak_rss_kb\n");
+    }
+    else {
+      printf("{\n  \"compiler\": \"%s\",\n  \"regex_backend\": \"%s\",\n"
+             "  \"build\": \"%s\",\n  \"results\": [\n",
+             compilerName().c_str(), regexBackend(), buildType());
+    }
+    for(size_t i=0; i<results.size(); i++) {
+      const result& r = results[i];
+      double ops = r.nbOps;
+      if(format == TABLE) {
+        printf("%-32s %8zu %12.1f %12.3f %12.1f %12ld\n", r.name.c_str(), r.nbKeys,
+               r.ns/ops, r.allocations/ops, r.allocatedBytes/ops, r.peakRssKb);
+      }
+      else if(format == CSV) {
+        printf("%s,%zu,%zu,%.2f,%.4f,%.2f,%ld\n", r.name.c_str(), r.nbKeys, r.nbOps,
+               r.ns/ops, r.allocations/ops, r.allocatedBytes/ops, r.peakRssKb);
+      }
+      else {
+        printf("    {\"benchmark\": \"%s\", \"keys\": %zu, \"ops\": %zu, \"ns_per_op\": %.2f, "
+               "\"allocs_per_op\": %.4f, \"bytes_per_op\": %.2f, \"peak_rss_kb\": %ld}%s\n",
+               r.name.c_str(), r.nbKeys, r.nbOps, r.ns/ops, r.allocations/ops,
+               r.allocatedBytes/ops, r.peakRssKb, i+1 < results.size() ? "," : "");
+      }
+    }
+    if(format == JSON) printf("  ]\n}\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  output_format format = TABLE;
+  size_t maxKeys = 1000000;
+  string dir = "/tmp";
+  for(int i=1; i<argc; i++) {
+    if(strcmp(argv[i], "--csv") == 0) format = CSV;
+    else if(strcmp(argv[i], "--json") == 0) format = JSON;
+    else if(strcmp(argv[i], "--max-keys") == 0 && i+1 < argc) maxKeys = strtoul(argv[++i], 0, 10);
+    else if(strcmp(argv[i], "--dir") == 0 && i+1 < argc) dir = argv[++i];
+    else {
+      fprintf(stderr, "Usage: %s [--csv | --json] [--max-keys N] [--dir D]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  vector<result> results;
+  size_t checksum = 0;
+  for(size_t nbKeys = 10; nbKeys <= maxKeys; nbKeys *= 10) {
+    string filepath = writeConfigFile(dir, nbKeys);
+    try {
+      benchLoading(filepath, nbKeys, results);
+      benchLookups(filepath, nbKeys, results, checksum);
+      benchLists(nbKeys, results, checksum);
+    } catch(std::exception& e) {
+      fprintf(stderr, "Error: %s\n", e.what());
+      remove(filepath.c_str());
+      return 1;
+    }
+    remove(filepath.c_str());
+  }
+  print(results, format);
+  // prevents the measured calls from being optimized away
+  if(format == TABLE) printf("\n(checksum %zu)\n", checksum);
+  return 0;
+}
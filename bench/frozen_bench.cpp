@@ -0,0 +1,126 @@
+// Measures the aggregate read throughput of a configuration shared by
+// several threads, comparing:
+//  - one copy of the config per thread (the previous practice),
+//  - a single config shared by all threads (typed values cached),
+//  - a single frozen_config shared by all threads.
+//
+// Usage: frozen_bench [nbKeys] [lookupsPerThread] [maxThreads]
+
+#include "config/config.hpp"
+#include "config/frozen_config.hpp"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+  typedef std::chrono::steady_clock bench_clock;
+
+  double elapsedMs(bench_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(bench_clock::now()-start).count();
+  }
+
+  /**
+   * Runs "work(threadIndex)" on "nbThreads" threads and returns the
+   * elapsed time in milliseconds.
+   */
+  double runThreads(size_t nbThreads, std::function<size_t(size_t)> work, size_t& checksum) {
+    vector<size_t> sums(nbThreads);
+    vector<std::thread> threads;
+    bench_clock::time_point start = bench_clock::now();
+    for(size_t t=0; t<nbThreads; t++)
+      threads.emplace_back([&, t]() { sums[t] = work(t); });
+    for(size_t t=0; t<nbThreads; t++) threads[t].join();
+    double ms = elapsedMs(start);
+    checksum = 0;
+    for(size_t t=0; t<nbThreads; t++) checksum += sums[t];
+    return ms;
+  }
+
+  void report(const char* name, size_t nbThreads, double ms, size_t nbLookups,
+              size_t checksum) {
+    printf("%-28s %3zu threads %10.2f Mlookups/s  (checksum %zu)\n",
+           name, nbThreads, nbLookups / ms / 1e3, checksum);
+  }
+
+  /// Reads a scalar and a list element, as a worker would.
+  template<class Config>
+  size_t readValues(const Config& conf, const vector<string>& keys,
+                    const vector<uint32_t>& queries) {
+    size_t sum = 0;
+    for(size_t i=0; i<queries.size(); i++) {
+      const string& key = keys[queries[i]];
+      if(key[0] == 'l') sum += conf.getIntList(key)[1];
+      else sum += conf.parseParamUInt(key);
+    }
+    return sum;
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t nbKeys = 10000;
+  size_t lookupsPerThread = 1000000;
+  size_t maxThreads = 64;
+  if(argc > 1) nbKeys = strtoul(argv[1], 0, 10);
+  if(argc > 2) lookupsPerThread = strtoul(argv[2], 0, 10);
+  if(argc > 3) maxThreads = strtoul(argv[3], 0, 10);
+
+  config conf;
+  vector<string> keys;
+  for(size_t i=0; i<nbKeys; i++) {
+    string key;
+    if(i%4 == 0) {
+      key = "list_" + std::to_string(i);
+      conf.addConfElem(key, "{" + std::to_string(i) + "," + std::to_string(i+1) + ",3}");
+    } else {
+      key = "param_" + std::to_string(i);
+      conf.addConfElem(key, std::to_string(i));
+    }
+    keys.push_back(key);
+  }
+
+  bench_clock::time_point start = bench_clock::now();
+  std::shared_ptr<const frozen_config> frozen = conf.freeze();
+  printf("%zu keys, %zu lookups per thread, freeze() took %.2f ms\n",
+         nbKeys, lookupsPerThread, elapsedMs(start));
+
+  vector< vector<uint32_t> > queries(maxThreads);
+  for(size_t t=0; t<maxThreads; t++) {
+    std::mt19937 rng(t);
+    queries[t].resize(lookupsPerThread);
+    for(size_t i=0; i<lookupsPerThread; i++) queries[t][i] = rng() % nbKeys;
+  }
+
+  for(size_t nbThreads=1; nbThreads<=maxThreads; nbThreads*=2) {
+    size_t nbLookups = nbThreads * lookupsPerThread;
+    size_t checksum;
+    double ms;
+
+    // each thread copies the configuration before reading it
+    ms = runThreads(nbThreads, [&](size_t t) {
+        config copy = conf;
+        return readValues(copy, keys, queries[t]);
+      }, checksum);
+    report("config copy per thread", nbThreads, ms, nbLookups, checksum);
+
+    ms = runThreads(nbThreads, [&](size_t t) {
+        return readValues(conf, keys, queries[t]);
+      }, checksum);
+    report("shared config", nbThreads, ms, nbLookups, checksum);
+
+    ms = runThreads(nbThreads, [&](size_t t) {
+        return readValues(*frozen, keys, queries[t]);
+      }, checksum);
+    report("shared frozen_config", nbThreads, ms, nbLookups, checksum);
+  }
+  return 0;
+}
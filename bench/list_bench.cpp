@@ -0,0 +1,122 @@
+// Measures the parsing of long numeric lists, comparing the bulk list
+// scanner used by config with the regex + std::stringstream splitting
+// + atof() sequence that was previously used.
+//
+// Usage: list_bench [nbElements] [nbRepetitions]
+
+#include "config/config.hpp"
+
+#include <regex>
+#include <stdlib.h>
+#include <stdio.h>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+  typedef std::chrono::steady_clock bench_clock;
+
+  /// Longest list parsed with the previous, regex-based parser.
+  const size_t REGEX_MAX_ELEMENTS = 2000;
+
+  double elapsedNs(bench_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(bench_clock::now()-start).count();
+  }
+
+  void report(const char* name, double ns, size_t nbElements, size_t nbBytes, double checksum) {
+    printf("%-36s %8.1f ns/element %8.1f MB/s  (checksum %g)\n",
+           name, ns/nbElements, nbBytes/ns*1e3, checksum);
+  }
+
+  /// The previous implementation of config::listParser(key, vector<double>&).
+  bool regexListParser(const string& val, vector<double>& listReturn) {
+    listReturn.clear();
+    std::regex r("\\{(.+)\\}");
+    std::smatch regexMatch;
+    if(!std::regex_search(val, regexMatch, r)) return false;
+    std::stringstream ss(regexMatch[1].str());
+    string item;
+    ss >> std::ws;
+    while(std::getline(ss, item, ',')) {
+      listReturn.push_back(atof(item.c_str()));
+      ss >> std::ws;
+    }
+    return true;
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t nbElements = 200000;
+  size_t nbReps = 5;
+  if(argc > 1) nbElements = strtoul(argv[1], 0, 10);
+  if(argc > 2) nbReps = strtoul(argv[2], 0, 10);
+
+  string val = "{";
+  for(size_t i=0; i<nbElements; i++) {
+    if(i > 0) val += ", ";
+    val += std::to_string(i * 0.000123 - 3.5);
+  }
+  val += "}";
+  printf("List of %zu real numbers (%zu bytes), %zu repetitions\n",
+         nbElements, val.size(), nbReps);
+  size_t total = nbElements * nbReps;
+  size_t totalBytes = val.size() * nbReps;
+
+  // std::regex recurses once per character of ".+", and overflows the
+  // stack on long lists: the previous parser is measured on a prefix
+  size_t regexElements = nbElements < REGEX_MAX_ELEMENTS ? nbElements : REGEX_MAX_ELEMENTS;
+  string regexVal = "{";
+  for(size_t i=0; i<regexElements; i++) {
+    if(i > 0) regexVal += ", ";
+    regexVal += std::to_string(i * 0.000123 - 3.5);
+  }
+  regexVal += "}";
+  double checksum = 0;
+  vector<double> v;
+  bench_clock::time_point start = bench_clock::now();
+  for(size_t r=0; r<nbReps; r++) {
+    regexListParser(regexVal, v);
+    checksum += v.back();
+  }
+  printf("(regex parser measured on the first %zu elements)\n", regexElements);
+  report("regex + stringstream + atof", elapsedNs(start), regexElements * nbReps,
+         regexVal.size() * nbReps, checksum);
+
+  // the first call parses and caches the list: use a new config each time
+  checksum = 0;
+  double ns = 0;
+  for(size_t r=0; r<nbReps; r++) {
+    config conf;
+    conf.addConfElem("coefficients", val);
+    start = bench_clock::now();
+    checksum += conf.getDoubleList("coefficients").back();
+    ns += elapsedNs(start);
+  }
+  report("config::getDoubleList (first call)", ns, total, totalBytes, checksum);
+
+  config conf;
+  conf.addConfElem("coefficients", val);
+  vector<double> buffer(conf.listSize("coefficients"));
+  checksum = 0;
+  start = bench_clock::now();
+  for(size_t r=0; r<nbReps; r++) {
+    conf.listParser("coefficients", buffer.data(), buffer.size());
+    checksum += buffer.back();
+  }
+  report("config::listParser (caller buffer)", elapsedNs(start), total, totalBytes, checksum);
+
+  vector<int> intBuffer(buffer.size());
+  checksum = 0;
+  start = bench_clock::now();
+  for(size_t r=0; r<nbReps; r++) {
+    conf.listParser("coefficients", intBuffer.data(), intBuffer.size());
+    checksum += intBuffer.back();
+  }
+  report("config::listParser (int buffer)", elapsedNs(start), total, totalBytes, checksum);
+  return 0;
+}
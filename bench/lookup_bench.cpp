@@ -0,0 +1,100 @@
+// Measures key lookup latency on a large configuration, comparing the
+// flat hash table used by config with the node-based containers and
+// by-value std::string keys it used previously.
+//
+// Usage: lookup_bench [nbKeys] [nbLookups]
+
+#include "config/config.hpp"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+  typedef std::chrono::steady_clock bench_clock;
+
+  double elapsedNs(bench_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(bench_clock::now()-start).count();
+  }
+
+  void report(const char* name, double ns, size_t nbLookups, size_t checksum) {
+    printf("%-40s %8.1f ns/lookup  (checksum %zu)\n", name, ns/nbLookups, checksum);
+  }
+
+  // Emulates the previous getter signature, which took the key by value.
+  template<class Map>
+  size_t findByValue(const Map& m, string key) {
+    typename Map::const_iterator it = m.find(key);
+    return it == m.end() ? 0 : it->second.size();
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t nbKeys = 10000;
+  size_t nbLookups = 2000000;
+  if(argc > 1) nbKeys = strtoul(argv[1], 0, 10);
+  if(argc > 2) nbLookups = strtoul(argv[2], 0, 10);
+
+  config conf;
+  std::map<string, string> stdMap;
+  std::unordered_map<string, string> hashMap;
+  vector<string> keys;
+  for(size_t i=0; i<nbKeys; i++) {
+    string key = "component_" + std::to_string(i%97) + ":param_" + std::to_string(i);
+    string val = std::to_string(i);
+    conf.addConfElem(key, val);
+    stdMap[key] = val;
+    hashMap[key] = val;
+    keys.push_back(key);
+  }
+
+  // random access pattern, with lookups given as c-strings (literals)
+  std::mt19937 rng(42);
+  vector<const char*> queries(nbLookups);
+  for(size_t i=0; i<nbLookups; i++) queries[i] = keys[rng() % nbKeys].c_str();
+
+  printf("%zu lookups in a configuration of %zu keys\n", nbLookups, nbKeys);
+
+  size_t checksum = 0;
+  bench_clock::time_point start = bench_clock::now();
+  for(size_t i=0; i<nbLookups; i++) checksum += findByValue(stdMap, queries[i]);
+  report("std::map, std::string key by value", elapsedNs(start), nbLookups, checksum);
+
+  checksum = 0;
+  start = bench_clock::now();
+  for(size_t i=0; i<nbLookups; i++) checksum += findByValue(hashMap, queries[i]);
+  report("std::unordered_map, std::string key", elapsedNs(start), nbLookups, checksum);
+
+  checksum = 0;
+  start = bench_clock::now();
+  for(size_t i=0; i<nbLookups; i++) checksum += conf.keyExists(queries[i]);
+  report("config::keyExists", elapsedNs(start), nbLookups, checksum);
+
+  checksum = 0;
+  start = bench_clock::now();
+  for(size_t i=0; i<nbLookups; i++) checksum += conf.getParamView(queries[i]).size();
+  report("config::getParamView", elapsedNs(start), nbLookups, checksum);
+
+  checksum = 0;
+  start = bench_clock::now();
+  for(size_t i=0; i<nbLookups; i++) checksum += conf.parseParamUInt(queries[i]);
+  report("config::parseParamUInt (cached)", elapsedNs(start), nbLookups, checksum);
+
+  vector<config::handle> handles(nbLookups);
+  for(size_t i=0; i<nbLookups; i++) handles[i] = conf.resolve(queries[i]);
+  checksum = 0;
+  start = bench_clock::now();
+  for(size_t i=0; i<nbLookups; i++) checksum += conf.parseParamUInt(handles[i]);
+  report("config::parseParamUInt (handle)", elapsedNs(start), nbLookups, checksum);
+
+  return 0;
+}
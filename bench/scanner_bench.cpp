@@ -0,0 +1,156 @@
+// Compares the hand-written line scanner used by config::initFile and
+// config::initCL with the regex backends that were previously used to
+// parse each line.
+//
+// Usage: scanner_bench [nbLines]
+
+#include "config/config.hpp"
+#include "config/private/LineScanner.hpp"
+
+#include <regex>
+#ifdef BENCH_BOOST_REGEX
+#include <boost/regex.hpp>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+
+namespace {
+
+  const string keyValRegex = "([[:alpha:][:digit:]_:-]+)[[:space:]]*=[[:space:]]*(.+)";
+
+  typedef std::chrono::steady_clock bench_clock;
+
+  double elapsedNs(bench_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(bench_clock::now()-start).count();
+  }
+
+  void report(const string& name, double ns, size_t nbLines, size_t checksum) {
+    printf("%-34s %12.1f ns/line %10.2f ms total  (checksum %zu)\n",
+           name.c_str(), ns/nbLines, ns/1e6, checksum);
+  }
+
+  vector<string> generateLines(size_t nbLines) {
+    vector<string> lines;
+    lines.reserve(nbLines);
+    for(size_t i=0; i<nbLines; i++) {
+      switch(i%4) {
+      case 0: lines.push_back("sweep_key_"+std::to_string(i)+" = "+std::to_string(i*7)); break;
+      case 1: lines.push_back("param:"+std::to_string(i)+"= 0."+std::to_string(i)); break;
+      case 2: lines.push_back("list-"+std::to_string(i)+" ={1,2,3,4,5,6,7,8}"); break;
+      default: lines.push_back("seq_"+std::to_string(i)+"=0:0.25:"+std::to_string(i)); break;
+      }
+    }
+    return lines;
+  }
+
+  void benchScanner(const vector<string>& lines) {
+    size_t checksum = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for(size_t i=0; i<lines.size(); i++) {
+      line_scanner::range key, val;
+      const char* begin = lines[i].data();
+      if(line_scanner::scanKeyVal(begin, begin+lines[i].size(), key, val))
+        checksum += key.size() + val.size();
+    }
+    report("line_scanner", elapsedNs(start), lines.size(), checksum);
+  }
+
+  template<class Regex, class Match, class Search>
+  void benchRegex(const string& name, const vector<string>& lines,
+                  bool perLine, Search search,
+                  typename Regex::flag_type flags) {
+    size_t checksum = 0;
+    bench_clock::time_point start = bench_clock::now();
+    Regex hoisted(keyValRegex, flags);
+    for(size_t i=0; i<lines.size(); i++) {
+      Match tokens;
+      if(perLine) {
+        Regex r(keyValRegex, flags);
+        if(search(lines[i], tokens, r))
+          checksum += tokens[1].length() + tokens[2].length();
+      } else {
+        if(search(lines[i], tokens, hoisted))
+          checksum += tokens[1].length() + tokens[2].length();
+      }
+    }
+    report(name, elapsedNs(start), lines.size(), checksum);
+  }
+
+  bool stdSearch(const string& s, std::smatch& m, const std::regex& r) {
+    return std::regex_search(s, m, r);
+  }
+
+#ifdef BENCH_BOOST_REGEX
+  bool boostSearch(const string& s, boost::smatch& m, const boost::regex& r) {
+    return boost::regex_search(s, m, r);
+  }
+#endif
+
+  void benchInitFile(const vector<string>& lines) {
+    const string path = "scanner_bench.cfg";
+    {
+      std::ofstream ofs(path.c_str());
+      for(size_t i=0; i<lines.size(); i++) ofs << lines[i] << "\n";
+    }
+    bench_clock::time_point start = bench_clock::now();
+    config conf;
+    conf.initFile(path);
+    report("config::initFile", elapsedNs(start), lines.size(),
+           conf.keyExists("sweep_key_0"));
+    start = bench_clock::now();
+    config mappedConf;
+    mappedConf.initFileMapped(path);
+    report("config::initFileMapped", elapsedNs(start), lines.size(),
+           mappedConf.keyExists("sweep_key_0"));
+    start = bench_clock::now();
+    config confCopy = mappedConf;
+    report("config copy", elapsedNs(start), lines.size(),
+           confCopy.keyExists("sweep_key_0"));
+    remove(path.c_str());
+  }
+
+  void benchInitCL(const vector<string>& lines) {
+    vector<char*> argv;
+    argv.push_back(const_cast<char*>("scanner_bench"));
+    for(size_t i=0; i<lines.size(); i++)
+      argv.push_back(const_cast<char*>(lines[i].c_str()));
+    bench_clock::time_point start = bench_clock::now();
+    config conf;
+    conf.initCL(argv.size(), argv.data());
+    report("config::initCL", elapsedNs(start), lines.size(),
+           conf.keyExists("sweep_key_0"));
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t nbLines = 20000;
+  if(argc > 1) nbLines = strtoul(argv[1], 0, 10);
+  vector<string> lines = generateLines(nbLines);
+
+  cout << "Parsing " << nbLines << " key=value lines" << endl;
+  benchScanner(lines);
+  benchRegex<std::regex, std::smatch>("std::regex (hoisted)", lines, false,
+                                      stdSearch, std::regex::ECMAScript);
+  benchRegex<std::regex, std::smatch>("std::regex (per line)", lines, true,
+                                      stdSearch, std::regex::ECMAScript);
+#ifdef BENCH_BOOST_REGEX
+  benchRegex<boost::regex, boost::smatch>("boost::regex (hoisted)", lines, false,
+                                          boostSearch, boost::regex::extended);
+  benchRegex<boost::regex, boost::smatch>("boost::regex (per line)", lines, true,
+                                          boostSearch, boost::regex::extended);
+#endif
+  benchInitFile(lines);
+  benchInitCL(lines);
+  return 0;
+}
@@ -0,0 +1,58 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef _array_view_hpp_
+#define _array_view_hpp_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Read-only view of a contiguous array of elements owned by someone
+ * else (like std::string_view for strings).
+ */
+template<class T>
+class array_view {
+
+public:
+
+  typedef T value_type;
+  typedef const T* const_iterator;
+  typedef const T* iterator;
+
+  array_view() : m_data(0), m_size(0) {}
+
+  array_view(const T* data, size_t size) : m_data(data), m_size(size) {}
+
+  array_view(const std::vector<T>& v) : m_data(v.data()), m_size(v.size()) {}
+
+  const T* data() const { return m_data; }
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  const T& operator[](size_t i) const { return m_data[i]; }
+
+  const T* begin() const { return m_data; }
+  const T* end() const { return m_data + m_size; }
+
+  /// Returns a copy of the elements.
+  std::vector<T> vector() const { return std::vector<T>(begin(), end()); }
+
+private:
+  const T* m_data;
+  size_t m_size;
+};
+
+template<class T>
+bool operator==(const array_view<T>& a, const array_view<T>& b) {
+  if(a.size() != b.size()) return false;
+  for(size_t i=0; i<a.size(); i++) {
+    if(!(a[i] == b[i])) return false;
+  }
+  return true;
+}
+
+template<class T>
+bool operator!=(const array_view<T>& a, const array_view<T>& b) { return !(a == b); }
+
+#endif
@@ -5,20 +5,128 @@
 #define _config_hpp_
 
 #include "private/CustomExceptions.hpp"
-#include <string>
+#include "private/ArgTable.hpp"
+#include "private/TypedCache.hpp"
+#include "private/ArrayFile.hpp"
+#include "private/LineScanner.hpp"
+#include "seq_range.hpp"
+#include "array_view.hpp"
+#include "matrix_view.hpp"
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iosfwd>
 #include <map>
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
-#include <unordered_set>
 
 typedef unsigned int uint;
 
+struct mapped_image;
+class image_builder;
+class parsed_file;
+class frozen_config;
+
 /**
  * Parsing and retrieving values from a configuration.
+ *
+ * Typed values (numbers, lists and sequences) are parsed the first
+ * time they are requested and cached until the configuration is
+ * modified. Const methods can be called concurrently from several
+ * threads; methods that modify the configuration cannot. A
+ * configuration that is only read after being loaded can be frozen
+ * (see freeze()) and shared between threads without any locking.
  */
 class config {
 
 public:
 
+  /**
+   * Identifies a key of a configuration. A handle is obtained once
+   * with resolve(), after which getters taking the handle index
+   * directly into the configuration's value table without looking up
+   * the key. A handle remains valid for the lifetime of the config
+   * object that resolved it (and of its copies), even if the
+   * configuration is modified afterwards. A default-constructed handle
+   * is invalid: the getters throw key_not_found when given one.
+   */
+  class handle {
+  public:
+    handle() : m_id(arg_table::npos) {}
+
+    /// Returns false if the handle was default-constructed.
+    bool valid() const { return m_id != arg_table::npos; }
+
+  private:
+    friend class config;
+    friend class frozen_config;
+    explicit handle(arg_table::id_type id) : m_id(id) {}
+
+    arg_table::id_type m_id;
+  };
+
+  /**
+   * Describes one value to read with getParams(): a key, and the
+   * variable that receives its value, whose type selects the getter
+   * (uint: parseParamUInt(), std::string_view: getParamView(),
+   * std::vector<int>: getIntList(), ...). Use sequence() for the
+   * elements of a sequence and option() for checkOption(). A key is
+   * required unless optional() is called, in which case the variable
+   * keeps its value when the key does not exist.
+   */
+  class binding {
+  public:
+    binding(std::string_view key, uint& dest)   : binding(key, UINT, &dest) {}
+    binding(std::string_view key, double& dest) : binding(key, DOUBLE, &dest) {}
+    binding(std::string_view key, bool& dest)   : binding(key, BOOL, &dest) {}
+    binding(std::string_view key, std::string& dest) : binding(key, STRING, &dest) {}
+    binding(std::string_view key, std::string_view& dest) : binding(key, VIEW, &dest) {}
+    binding(std::string_view key, seq_range<uint>& dest) : binding(key, UINT_RANGE, &dest) {}
+    binding(std::string_view key, seq_range<double>& dest)
+      : binding(key, DOUBLE_RANGE, &dest) {}
+    binding(std::string_view key, std::vector<int>& dest) : binding(key, INT_LIST, &dest) {}
+    binding(std::string_view key, std::vector<double>& dest)
+      : binding(key, DOUBLE_LIST, &dest) {}
+    binding(std::string_view key, std::vector<std::string>& dest)
+      : binding(key, STRING_LIST, &dest) {}
+
+    static binding sequence(std::string_view key, std::vector<uint>& dest) {
+      return binding(key, UINT_SEQUENCE, &dest);
+    }
+    static binding sequence(std::string_view key, std::vector<double>& dest) {
+      return binding(key, DOUBLE_SEQUENCE, &dest);
+    }
+    /// Sets "dest" to whether the option was specified (never required).
+    static binding option(std::string_view key, bool& dest) {
+      binding b(key, OPTION, &dest);
+      b.m_required = false;
+      return b;
+    }
+
+    binding& optional() {
+      m_required = false;
+      return *this;
+    }
+
+  private:
+    friend class config;
+
+    enum type {
+      UINT, DOUBLE, BOOL, STRING, VIEW, OPTION, UINT_RANGE, DOUBLE_RANGE,
+      UINT_SEQUENCE, DOUBLE_SEQUENCE, INT_LIST, DOUBLE_LIST, STRING_LIST
+    };
+
+    binding(std::string_view key, type t, void* dest)
+      : m_key(key), m_type(t), m_dest(dest), m_required(true) {}
+
+    std::string_view m_key;
+    type m_type;
+    void* m_dest;
+    bool m_required;
+  };
+
   config();
 
   /**
@@ -27,23 +135,52 @@ public:
    * of two types: "key-value pair", or "option". A key-value pair is
    * "<key>=<value>", and an option is "--<option>".
    *
+   * An element "@<path>" is a response file, which holds more
+   * elements, one per line (blank lines and comment lines starting
+   * with "#" are ignored, and a response file can refer to others).
+   * Response files are streamed rather than read whole, so that very
+   * large argument lists do not need to fit within the system's
+   * command-line limit. A relative path in a response file is
+   * resolved from the directory of that file.
+   *
    *@param argc The number of elements in argv.
    *@param argv Array of c-strings.
    *@throws invalidkey_exception  If a key or option is deemed invalid.
-   *@throws syntax_exception      If some element has invalid syntax.
+   *@throws syntax_exception      If some element has invalid syntax, or
+   *                              if response files refer to each other
+   *                              in a cycle.
+   *@throws file_exception        If a response file cannot be read.
    */
   void initCL(int argc, char** argv);
 
+  /// First character of a response file argument (see initCL()).
+  static const char RESPONSE_FILE_CHAR = '@';
+
   /**
    * Initializes the configuration from a file. Keys that already exist
    * are not deleted, but the values in the file takes precedence. Only
    * the "key-value pair" syntax is allowed in the file, as well as
-   * comment lines starting with "#".
+   * comment lines starting with "#" and include directives:
+   *
+   *   include <path>
+   *
+   * which load the key-value pairs of another file at that point, as
+   * if its lines were pasted in place of the directive. A relative
+   * path is resolved from the directory of the including file.
+   * Included files are read through a process-wide cache, so that a
+   * fragment shared by many configurations is parsed only once (as
+   * long as it is not modified). A line is an include directive only
+   * if it is not a "<key>=<value>" expression.
+   *
+   * Exceptions thrown while reading a file give the file and line of
+   * the error through their location() method.
    *@param filepath
    *@throws file_exception        If there is a problem reading from the file
-   *                              specified by "filepath".
+   *                              specified by "filepath", or from an
+   *                              included file.
    *@throws invalidkey_exception  If a key is deemed invalid.
-   *@throws syntax_exception      If some line has invalid syntax.
+   *@throws syntax_exception      If some line has invalid syntax, or if
+   *                              files include each other in a cycle.
    */
 	void initFile(std::string filepath) { return initFile(filepath, false); }
 
@@ -60,62 +197,236 @@ public:
 	 */
 	void initFile(std::string filepath, bool keepExisting);
 
+  /**
+   * Initializes the configuration from several files, with the same
+   * result as calling initFile(path, keepExisting) on each of them in
+   * order: by default, a value in a file takes precedence over the
+   * values of the preceding files. The files are read and tokenized in
+   * parallel, and the tokens of a file are reused by later loads (in
+   * the same process) as long as the file's modification time, size
+   * and inode are unchanged.
+   *
+   * If a file cannot be read or contains an error, the files that
+   * precede it and the lines that precede the error are applied (as
+   * with the sequential calls) before the exception is thrown.
+   *
+   *@throws file_exception        If there is a problem reading from a file.
+   *@throws invalidkey_exception  If a key is deemed invalid.
+   *@throws syntax_exception      If some line has invalid syntax.
+   */
+  void initFiles(const std::vector<std::string>& filepaths) {
+    initFiles(filepaths, false);
+  }
+
+  void initFiles(const std::vector<std::string>& filepaths, bool keepExisting);
+
+  /**
+   * Drops the tokens of the files cached by initFiles(), for instance
+   * when files may have been modified without changing their
+   * modification time.
+   */
+  static void clearParseCache();
+
+  /**
+   * Same as initFile(std::string), but the file is memory-mapped and
+   * parsed in place: no per-line string or stream is built, and keys
+   * and values are copied directly into the configuration's arena.
+   * The file must be a regular file (not a pipe).
+   *@param filepath
+   *@throws file_exception        If the file cannot be opened or mapped.
+   *@throws invalidkey_exception  If a key is deemed invalid.
+   *@throws syntax_exception      If some line has invalid syntax.
+   */
+  void initFileMapped(std::string filepath) { return initFileMapped(filepath, false); }
+
+  /**
+   * Similar to initFileMapped(std::string), but in case of key
+   * conflict, parameter "keepExisting" defines the behavior (see
+   * initFile(std::string, bool)).
+   */
+  void initFileMapped(std::string filepath, bool keepExisting);
+
+  /**
+   * Called by streamFile() for each key-value pair. The views are only
+   * valid during the call.
+   */
+  typedef std::function<void(std::string_view key, std::string_view val)> stream_callback;
+
+  /// Default size of the chunks read by streamFile().
+  static const size_t STREAM_CHUNK_SIZE = 1 << 20;
+
+  /**
+   * Parses a configuration file like initFile(), but instead of
+   * storing the key-value pairs in the configuration, calls "callback"
+   * for each of them in the order of the file. The file is read in
+   * chunks of "chunkSize" bytes, so memory use is bounded by the chunk
+   * size (or by the longest line, if it is longer), not by the size of
+   * the file. Keys are checked against the valid keys, if any (see
+   * addValidKey()). An empty callback only validates the file.
+   * Included files are streamed in turn, each with its own buffer.
+   * If the callback throws a syntax_exception or an
+   * invalidkey_exception without a location, it is thrown again with
+   * the location of the current line.
+   *@return The number of key-value pairs in the file.
+   *@throws file_exception        If the file cannot be read.
+   *@throws invalidkey_exception  If a key is deemed invalid.
+   *@throws syntax_exception      If some line has invalid syntax.
+   */
+  size_t streamFile(std::string filepath, stream_callback callback,
+                    size_t chunkSize = STREAM_CHUNK_SIZE) const;
+
+  /**
+   * Expands the references in the values of the configuration, and
+   * stores the expanded values in place of the original ones:
+   *
+   *   ${<key>}      the (expanded) value of another key
+   *   ${env:<var>}  the value of an environment variable
+   *   $${           a literal "${"
+   *
+   * Each value is expanded once, after the values it refers to, so
+   * getters never expand anything. Call it after all the layers of the
+   * configuration are loaded (files, command line); to derive several
+   * variants from a base configuration, copy the base before calling
+   * it, then load each variant's overrides into a copy and expand it.
+   * Calling it again only expands the values set since: an expanded
+   * value that contains a literal "${" is kept as is until it is
+   * replaced.
+   *@return The number of values that were modified.
+   *@throws key_not_found     If a value refers to a key or an environment
+   *                          variable that does not exist ("env:<var>"
+   *                          is reported for a variable).
+   *@throws syntax_exception  If values refer to each other in a cycle, or
+   *                          a reference is not terminated by '}'.
+   */
+  size_t interpolate();
+
+  /**
+   * Writes a binary snapshot of the configuration to "filepath". The
+   * snapshot contains the keys and values as well as every typed value
+   * (number, list, sequence) parsed from them, and identifies the
+   * version (modification time and content hash) of every file the
+   * configuration was loaded from, including included files and
+   * response files. It should therefore be saved right after loading
+   * those files. The file is written atomically (it is written
+   * under a temporary name, then renamed).
+   *@throws file_exception  If the snapshot or the source file cannot be
+   *                        accessed.
+   */
+  void saveSnapshot(std::string filepath) const;
+
+  /**
+   * Replaces the key-value pairs of the configuration with the ones
+   * of a snapshot written by saveSnapshot(). The snapshot is mapped
+   * and its key-value pairs are copied as a few blocks. It remains
+   * mapped so that typed values are read from it instead of being
+   * parsed. Only
+   * the source files are checked: a snapshot of a configuration that
+   * also includes command-line arguments does not reflect changes to
+   * those arguments.
+   *@throws file_exception        If the snapshot cannot be read.
+   *@throws snapshot_exception    If the snapshot is invalid (corrupt or
+   *                              from another version of the library), or
+   *                              stale: one of its source files was
+   *                              modified or removed since it was saved.
+   *@throws invalidkey_exception  If a key is deemed invalid.
+   */
+  void loadSnapshot(std::string filepath);
+
+  /**
+   * Returns an immutable copy of the configuration in which every
+   * value has already been parsed. Its getters are safe to call from
+   * any number of threads (see frozen_config). Handles resolved on
+   * this configuration can be used with the frozen copy.
+   */
+  std::shared_ptr<const frozen_config> freeze() const;
+
   /**
    * Defines key "key" as being valid in a configuration. Calling this
    * method automatically activates key checking, and an exception
    * will be thrown if invalid keys are encountered while parsing a
    * configuration.
    */
-  void addValidKey(std::string key) { 
+  void addValidKey(std::string_view key) { 
     m_checkKeys=true;
-    m_validKeys.insert(key);
+    m_validKeys.set(key, "", false);
   }
 
-  void addValidOption(std::string option) {
+  void addValidOption(std::string_view option) {
     m_checkKeys=true;
-    m_validOptions.insert(option);
+    m_validOptions.set(option, "", false);
   }
 
 	/**
 	 * Parses an unsigned integer parameter.
 	 *@throws key_not_found  If the specified key does not exist.
 	 */
-  uint   parseParamUInt(std::string key) const;
+  uint   parseParamUInt(std::string_view key) const;
 
-  double parseParamDouble(std::string key) const;
+  double parseParamDouble(std::string_view key) const;
 
-  bool   parseParamBool(std::string key) const;
+  bool   parseParamBool(std::string_view key) const;
 
-  std::string getParamString(std::string key) const;
+  std::string getParamString(std::string_view key) const;
+
+  /**
+   * Same as getParamString(), but returns a view of the stored value
+   * instead of a copy. The view remains valid until the configuration
+   * is modified.
+   *@throws key_not_found  If the specified key does not exist.
+   */
+  std::string_view getParamView(std::string_view key) const;
 
   /**
    * Returns true if the option has been specified, false
    * otherwise. Only the option name must be provided as the key,
    * without the "--".
    */
-  bool checkOption(std::string key) const;
+  bool checkOption(std::string_view key) const;
+
+  /**
+   * Returns the sequence of integers described by the value of "key",
+   * of the form "<start>:<increment>:<end>" (end included). The
+   * elements are computed on access: the sequence is not stored, and
+   * can be split among workers with seq_range::shard().
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid sequence.
+   */
+  seq_range<uint> getUIntRange(std::string_view key) const;
+
+  /**
+   * Returns the sequence of real numbers described by the value of
+   * "key", either linear ("<start>:<increment>:<end>") or exponential
+   * ("<start>*<multiplier>:<end>"). Element i is computed as start +
+   * i*increment (or start * multiplier^i), so elements do not
+   * accumulate rounding errors. The end value is included if it is
+   * within 1e-9 steps of an element.
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid sequence, or
+   *                          describes an infinite sequence.
+   */
+  seq_range<double> getDoubleRange(std::string_view key) const;
 
   /**
    * Parses syntax describing a sequence of integers, and adds each element in the
-   * sequence to "seqReturn".
+   * sequence to "seqReturn" (see getUIntRange()).
    *@param key     Name of the key associated with the desired sequence.
    *@param seqReturn  This vector is cleared and elements are added to it.
    *@return 'true' if a valid sequence was found, 'false' otherwise (in that case 
    *        seqReturn will be empty)
    *@throws key_not_found  If the specified key does not exist.
    */
-  bool sequenceParser(std::string key, std::vector<uint>& seqReturn) const;
+  bool sequenceParser(std::string_view key, std::vector<uint>& seqReturn) const;
 
   /**
    * Parses syntax describing a sequence of real numbers, and adds each element
-   * in the sequence to "seqReturn".
+   * in the sequence to "seqReturn" (see getDoubleRange()).
    *@param key     Name of the key associated with the desired sequence.
    *@param seqReturn  This vector is cleared and elements are added to it.
    *@return 'true' if a valid sequence was found, 'false' otherwise (in that case 
    *        seqReturn will be empty)
    *@throws key_not_found  If the specified key does not exist.
    */
-  bool sequenceParser(std::string key, std::vector<double>& seqReturn) const;
+  bool sequenceParser(std::string_view key, std::vector<double>& seqReturn) const;
 
   /**
    * Parses a string describing a list, of the form "{<item1>,
@@ -126,7 +437,7 @@ public:
    *        "listReturn" will be empty)
    *@throws key_not_found  If the specified key does not exist.
    */
-  bool listParser(std::string key, std::vector<int>& listReturn) const;
+  bool listParser(std::string_view key, std::vector<int>& listReturn) const;
 
   /**
    * Parses a string describing a list, of the form "{<item1>,
@@ -138,7 +449,7 @@ public:
    *        "listReturn" will be empty)
    *@throws key_not_found  If the specified key does not exist.
    */
-  bool listParser(std::string key, std::vector<double>& listReturn) const;
+  bool listParser(std::string_view key, std::vector<double>& listReturn) const;
 
   /**
    * Parses a string describing a list, of the form "{<item1>,
@@ -149,7 +460,213 @@ public:
    *        "listReturn" will be empty)
    *@throws key_not_found  If the specified key does not exist.
    */
-  bool listParser(std::string key, std::vector<std::string>& listReturn) const;
+  bool listParser(std::string_view key, std::vector<std::string>& listReturn) const;
+
+  /**
+   * Returns the number of elements of the list described by the value
+   * of "key", without parsing them.
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid list.
+   */
+  size_t listSize(std::string_view key) const;
+
+  /**
+   * Parses the list described by the value of "key" directly into
+   * "out", which has room for "capacity" elements. No memory is
+   * allocated and the list is not cached, which suits very long lists
+   * that are read once. listSize() gives the capacity needed.
+   *@return The number of elements of the list. Only the first
+   *        "capacity" elements are written.
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid list.
+   */
+  size_t listParser(std::string_view key, int* out, size_t capacity) const;
+  size_t listParser(std::string_view key, double* out, size_t capacity) const;
+
+  /**
+   * Returns the elements of the binary array referenced by the value
+   * of "key", of the form "@file:<path>". A relative path is relative
+   * to the directory of the file the value was read from (an included
+   * file, for instance), or of getFilePath() for a value set from the
+   * command line or by addConfElem(). The type of the elements is
+   * given by the extension of the file: ".f64" (double), ".f32"
+   * (float), ".i64" (int64_t) or ".i32" (int32_t), stored as raw
+   * little-endian values. The file is memory-mapped the first time it
+   * is accessed, and its elements are used in place: the view remains
+   * valid until the configuration is modified.
+   *
+   * The list getters and listParser() also accept array references,
+   * and convert the elements (conversions to int saturate).
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a reference to an array
+   *                          with elements of that type.
+   *@throws file_exception    If the file cannot be mapped, or its size is
+   *                          not a multiple of the size of an element.
+   */
+  array_view<double>  getDoubleArray(std::string_view key) const;
+  array_view<float>   getFloatArray(std::string_view key) const;
+  array_view<int64_t> getInt64Array(std::string_view key) const;
+  array_view<int32_t> getInt32Array(std::string_view key) const;
+
+  /**
+   * Returns a reference to the cached sequence of integers described
+   * by the value of "key" (see sequenceParser(std::string,
+   * std::vector<uint>&)). The reference remains valid until the
+   * configuration is modified.
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid sequence.
+   */
+  const std::vector<uint>& getUIntSequence(std::string_view key) const;
+
+  /**
+   * Returns a reference to the cached sequence of real numbers
+   * described by the value of "key" (see sequenceParser(std::string,
+   * std::vector<double>&)).
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid sequence.
+   */
+  const std::vector<double>& getDoubleSequence(std::string_view key) const;
+
+  /**
+   * Returns a reference to the cached list of integers described by
+   * the value of "key" (see listParser(std::string, std::vector<int>&)).
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid list.
+   */
+  const std::vector<int>& getIntList(std::string_view key) const;
+
+  /**
+   * Returns a reference to the cached list of real numbers described
+   * by the value of "key".
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid list.
+   */
+  const std::vector<double>& getDoubleList(std::string_view key) const;
+
+  /**
+   * Returns a reference to the cached list of strings described by
+   * the value of "key".
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid list.
+   */
+  const std::vector<std::string>& getStringList(std::string_view key) const;
+
+  /**
+   * Returns a view of the cached elements of the nested list of
+   * numbers described by the value of "key", e.g. "{{1, 2}, {3, 4}}"
+   * for a 2x2 matrix. The elements are stored contiguously in
+   * row-major order, and the shape gives the size of each level of
+   * nesting. A flat list "{1, 2, 3}" has rank 1. Each element must be
+   * entirely a number, the lists of a level must all have the same
+   * size, and there are at most 32 levels. The view remains valid
+   * until the configuration is modified.
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid nested list, or
+   *                          is ragged.
+   */
+  matrix_view<int>    getIntMatrix(std::string_view key) const;
+  matrix_view<double> getDoubleMatrix(std::string_view key) const;
+
+  /**
+   * Returns a handle for "key", which can be passed to the getters
+   * below instead of the key name.
+   *@throws key_not_found  If the specified key does not exist.
+   */
+  handle resolve(std::string_view key) const;
+
+  // Same as the getters above, but the key is specified by a handle
+  // obtained from resolve(). They throw key_not_found if the handle is
+  // invalid, or does not refer to a key of this configuration.
+  uint   parseParamUInt(handle h) const;
+  double parseParamDouble(handle h) const;
+  bool   parseParamBool(handle h) const;
+  std::string getParamString(handle h) const;
+  std::string_view getParamView(handle h) const;
+  seq_range<uint>   getUIntRange(handle h) const;
+  seq_range<double> getDoubleRange(handle h) const;
+  bool sequenceParser(handle h, std::vector<uint>& seqReturn) const;
+  bool sequenceParser(handle h, std::vector<double>& seqReturn) const;
+  bool listParser(handle h, std::vector<int>& listReturn) const;
+  bool listParser(handle h, std::vector<double>& listReturn) const;
+  bool listParser(handle h, std::vector<std::string>& listReturn) const;
+  size_t listSize(handle h) const;
+  size_t listParser(handle h, int* out, size_t capacity) const;
+  size_t listParser(handle h, double* out, size_t capacity) const;
+  array_view<double>  getDoubleArray(handle h) const;
+  array_view<float>   getFloatArray(handle h) const;
+  array_view<int64_t> getInt64Array(handle h) const;
+  array_view<int32_t> getInt32Array(handle h) const;
+  const std::vector<uint>&        getUIntSequence(handle h) const;
+  const std::vector<double>&      getDoubleSequence(handle h) const;
+  const std::vector<int>&         getIntList(handle h) const;
+  const std::vector<double>&      getDoubleList(handle h) const;
+  const std::vector<std::string>& getStringList(handle h) const;
+  matrix_view<int>                getIntMatrix(handle h) const;
+  matrix_view<double>             getDoubleMatrix(handle h) const;
+
+  /**
+   * Reads the values described by "bindings" into their variables,
+   * looking up each key once. Keys are all looked up before any
+   * variable is written, so if a required key is missing, no variable
+   * is modified.
+   *
+   *   conf.getParams({ {"nb_iter", nbIter}, {"codes", codes},
+   *                    config::binding("snr", snr).optional() });
+   *
+   *@return The number of keys that exist.
+   *@throws key_not_found     If a required key does not exist.
+   *@throws syntax_exception  If a list, range or sequence is not valid.
+   */
+  size_t getParams(std::initializer_list<binding> bindings) const {
+    return getParams(bindings.begin(), bindings.size());
+  }
+
+  size_t getParams(const binding* bindings, size_t nbBindings) const;
+
+  // ---------- Non-throwing getters ----------
+  //
+  // For optional keys: these return an empty value (std::nullopt or a
+  // null pointer) instead of throwing key_not_found when the key does
+  // not exist, or syntax_exception when its value is not valid for the
+  // type. They allocate nothing beyond the values cached by the
+  // throwing getters. Pointers and views remain valid until the
+  // configuration is modified. A list that references an array file
+  // that cannot be mapped still throws file_exception.
+
+  std::optional<handle>           tryResolve(std::string_view key) const;
+  std::optional<uint>             tryParamUInt(std::string_view key) const;
+  std::optional<double>           tryParamDouble(std::string_view key) const;
+  std::optional<bool>             tryParamBool(std::string_view key) const;
+  std::optional<std::string_view> tryParamView(std::string_view key) const;
+  std::optional<seq_range<uint>>   tryUIntRange(std::string_view key) const;
+  std::optional<seq_range<double>> tryDoubleRange(std::string_view key) const;
+  const std::vector<uint>*        tryUIntSequence(std::string_view key) const;
+  const std::vector<double>*      tryDoubleSequence(std::string_view key) const;
+  const std::vector<int>*         tryIntList(std::string_view key) const;
+  const std::vector<double>*      tryDoubleList(std::string_view key) const;
+  const std::vector<std::string>* tryStringList(std::string_view key) const;
+
+  /**
+   * Returns the value of "key" as the type of "def", or "def" if the
+   * key does not exist or its value is not valid for that type. An int
+   * is parsed like parseParamUInt() (as by atoi()), a vector as a list
+   * (see getIntList() and co.) and a seq_range as a sequence. Returned
+   * references are either to the cached value or to "def".
+   */
+  uint   getOr(std::string_view key, uint def) const;
+  int    getOr(std::string_view key, int def) const;
+  double getOr(std::string_view key, double def) const;
+  bool   getOr(std::string_view key, bool def) const;
+  std::string_view getOr(std::string_view key, std::string_view def) const;
+  std::string_view getOr(std::string_view key, const char* def) const {
+    return getOr(key, std::string_view(def));
+  }
+  seq_range<uint>   getOr(std::string_view key, const seq_range<uint>& def) const;
+  seq_range<double> getOr(std::string_view key, const seq_range<double>& def) const;
+  const std::vector<int>&    getOr(std::string_view key, const std::vector<int>& def) const;
+  const std::vector<double>& getOr(std::string_view key, const std::vector<double>& def) const;
+  const std::vector<std::string>& getOr(std::string_view key,
+                                        const std::vector<std::string>& def) const;
 
   /**
    * Returns the file path that was passed to initFile(), or an empty
@@ -168,37 +685,269 @@ public:
    * Adds a new string element to the configuration.
    *@throws invalidkey_exception if the key already exists
    */
-  void addConfElem(std::string key, std::string val);
+  void addConfElem(std::string_view key, std::string_view val);
 
 	/**
 	 * Checks whether the specified key exists in the configuration.
 	 */
-	bool keyExists(std::string key) const;
+	bool keyExists(std::string_view key) const;
+
+#ifdef CONFIG_INSTRUMENTATION
+  // ---------- Access instrumentation ----------
+  //
+  // Only available when the library is compiled with
+  // CONFIG_INSTRUMENTATION defined (cmake -DCONFIG_INSTRUMENTATION=ON).
+  // Every getter then counts its calls per key, and the time spent
+  // parsing or copying each value is accumulated. Getters taking a
+  // key and getters taking a handle are counted alike.
+
+  typedef access_stats::key_access key_access;
+
+  ~config();
+
+  /**
+   * Returns the access statistics of every key, in the order in which
+   * the keys were added. Counts recorded before loadSnapshot() remain
+   * associated with entry ids, not key names.
+   */
+  std::vector<key_access> accessReport() const;
+
+  /// Returns the keys that have never been read.
+  std::vector<std::string> unusedKeys() const;
+
+  /**
+   * Returns the statistics of the "n" keys with the most lookups, the
+   * most accessed first.
+   */
+  std::vector<key_access> hotKeys(size_t n) const;
+
+  /**
+   * Writes the access statistics of every key as CSV lines, the most
+   * accessed keys first.
+   */
+  void writeAccessReport(std::ostream& os) const;
+
+  /**
+   * Writes the access report (see writeAccessReport()) to "filepath"
+   * when the program exits, or when this configuration is destroyed if
+   * that happens first. Reports of several configurations registered
+   * with the same file are appended to it.
+   */
+  void dumpAccessReportAtExit(std::string filepath) const;
+#endif
 
 private:
 
+  friend class schema_value;
+  friend class config_diff;
+
+  /**
+   * Returns the id of the entry for "key".
+   *@throws key_not_found  If the specified key does not exist.
+   */
+  arg_table::id_type lookup(std::string_view key) const;
+
+  /**
+   * Checks that "h" refers to an entry of this configuration.
+   *@throws key_not_found  If it does not (e.g. a default handle).
+   */
+  void checkHandle(handle h) const {
+    if(h.m_id >= m_argMap.size()) throw key_not_found("(invalid handle)");
+  }
+
+  /// Index of a file in m_sourceFiles, for entries not read from a file.
+  static constexpr uint32_t NO_SOURCE = 0xFFFFFFFF;
+
+  /**
+   * Records that the content of "filepath" is loaded (see m_sourceFiles).
+   *@return The index of "filepath" in m_sourceFiles.
+   */
+  uint32_t addSourceFile(const std::string& filepath);
+
+  /**
+   * Stores a key-value pair read from the file of index "source" in
+   * m_sourceFiles (or NO_SOURCE). An existing value is replaced only
+   * when "overwrite" is true, and then takes the new source. Every
+   * setter except interpolate() stores its values with this function.
+   */
+  void setEntry(std::string_view key, std::string_view val, bool overwrite,
+                uint32_t source);
+
+  /**
+   * Path of the file that entry "id" was read from, against which its
+   * relative "@file:" references are resolved. Entries that were not
+   * read from a file are resolved against m_filePath.
+   */
+  const std::string& sourcePathOf(arg_table::id_type id) const;
+
+  /**
+   * Stores the command-line element [begin, end), a key-value pair or
+   * an option, found at line "lineNumber" of response file "filepath"
+   * (empty for an element of argv), of index "source" in m_sourceFiles.
+   *@throws invalidkey_exception
+   *@throws syntax_exception
+   */
+  void setArgument(const char* begin, const char* end,
+                   const std::string& filepath, size_t lineNumber, uint32_t source);
+
+  /**
+   * Stores the elements of the response file "responsePath", referred
+   * to at line "lineNumber" of "filepath" (empty for argv).
+   * "responseStack" holds the canonical paths of the response files
+   * being read, to detect cycles.
+   *@throws file_exception
+   *@throws invalidkey_exception
+   *@throws syntax_exception
+   */
+  void initResponseFile(const std::string& responsePath, const std::string& filepath,
+                        size_t lineNumber, std::vector<std::string>& responseStack);
+
+  /**
+   * Cached scalar values of entry "id", which are not counted as
+   * accesses (see parseParamUInt() and co.).
+   */
+  uint   cachedUInt(arg_table::id_type id) const;
+  double cachedDouble(arg_table::id_type id) const;
+  bool   cachedBool(arg_table::id_type id) const;
+
+  /// Throws a syntax_exception for the value of entry "id".
+  void throwSyntax(arg_table::id_type id) const;
+
+  /**
+   * Returns the content of the list described by the value of entry
+   * "id" (between the brackets).
+   *@throws syntax_exception  If the value is not a valid list.
+   */
+  line_scanner::range listContent(arg_table::id_type id) const;
+
+  /**
+   * Returns the range parsed from the value of entry "id", parsing it
+   * if it is not cached yet.
+   */
+  template<class T>
+  const parsed_range<T>& cachedRange(arg_table::id_type id, typed_cache::kind k) const;
+
+  /**
+   * Returns the elements of the range of entry "id", generating them
+   * if they are not cached yet.
+   */
+  template<class T>
+  const parsed_list<T>& cachedSequence(arg_table::id_type id, typed_cache::kind k,
+                                       typed_cache::kind rangeKind) const;
+
+  /**
+   * Returns the list parsed from the value of entry "id", parsing it
+   * if it is not cached yet.
+   */
+  template<class T>
+  const parsed_list<T>& cachedList(arg_table::id_type id, typed_cache::kind k) const;
+
+  /**
+   * Returns the nested list parsed from the value of entry "id",
+   * parsing it if it is not cached yet.
+   */
+  template<class T>
+  const parsed_matrix<T>& cachedMatrix(arg_table::id_type id, typed_cache::kind k) const;
+
+  /**
+   * Returns the array file referenced by the value of entry "id",
+   * mapping it if it is not mapped yet.
+   *@throws syntax_exception  If the value is not an array reference.
+   *@throws file_exception
+   */
+  const array_file& cachedArray(arg_table::id_type id) const;
+
+  /**
+   * Returns the elements of the array of entry "id", which must be of
+   * type "t".
+   */
+  template<class T>
+  array_view<T> typedArray(arg_table::id_type id, array_file::elem_type t) const;
+
   /**
-   * Returns the next line from the ifstream object, skipping over
-   * comment lines.
-   *@param ifs
-   *@param line  Set to the next non-comment line, or to an empty 
-   *             string if the end of stream has been reached.
+   * Returns true if the configuration was loaded from a snapshot that
+   * stores the value of kind "k" of entry "id".
    */
-  void getline_nc(std::ifstream& ifs, std::string& line);
+  bool snapshotHas(arg_table::id_type id, typed_cache::kind k) const;
 
   /**
-   * Tokenizes a string according to the delimiter specified. The
-   * tokens are added to "elems".
+   * Parses every kind of value of every entry into "builder", so that
+   * the image it produces needs no parsing. Only the kinds that are
+   * valid for a value are stored, and array references are stored as
+   * the reference (they are not mapped).
    */
-  std::vector<std::string>& split(const std::string& s, char delim, std::vector<std::string>& elems) const;
+  void buildImage(image_builder& builder) const;
 
-	std::string& trim(std::string& str) const;
-	std::string& ltrim(std::string& str) const;
-	std::string& rtrim(std::string& str) const;
+  /**
+   * Parses a value describing a sequence (see getUIntRange() and
+   * getDoubleRange()).
+   *@return 'true' if the syntax is valid.
+   */
+  static bool parseSequence(std::string_view val, seq_range<uint>& range);
+  static bool parseSequence(std::string_view val, seq_range<double>& range);
+
+  /**
+   * Parses a value describing a list (see listParser()).
+   *@return 'true' if the syntax is valid.
+   */
+  bool parseList(std::string_view val, std::vector<int>& listReturn) const;
+  bool parseList(std::string_view val, std::vector<double>& listReturn) const;
+  bool parseList(std::string_view val, std::vector<std::string>& listReturn) const;
+
+  /**
+   * Scans a trimmed, non-comment line (line "lineNumber" of file
+   * "filepath") for a key-value pair, which is checked, or for an
+   * include directive.
+   *@param key  Set to the key, or to the path of an included file.
+   *@return 'true' for a key-value pair, 'false' for an include directive.
+   *@throws invalidkey_exception
+   *@throws syntax_exception
+   */
+  bool scanLine(const char* begin, const char* end,
+                line_scanner::range& key, line_scanner::range& val,
+                const std::string& filepath, size_t lineNumber) const;
+
+  /**
+   * Loads the file included by "includePath" at line "lineNumber" of
+   * file "filepath". "includeStack" holds the canonical paths of the
+   * files being loaded, to detect cycles.
+   *@throws file_exception
+   *@throws invalidkey_exception
+   *@throws syntax_exception
+   */
+  void includeFile(std::string_view includePath, const std::string& filepath,
+                   size_t lineNumber, bool keepExisting,
+                   std::vector<std::string>& includeStack);
+
+  /**
+   * Stores the key-value pairs of a parsed file (read from "filepath",
+   * of index "source" in m_sourceFiles), and loads the files it includes.
+   */
+  void applyFile(const parsed_file& file, const std::string& filepath,
+                 uint32_t source, bool keepExisting,
+                 std::vector<std::string>& includeStack);
+
+  /**
+   * Streams the open file "fd" (see streamFile()), and closes it.
+   */
+  size_t streamFile(int fd, const std::string& filepath,
+                    const stream_callback& callback, size_t chunkSize,
+                    std::vector<std::string>& includeStack) const;
 
   // ---------- Data Members ----------
 
-  std::map<std::string, std::string> m_argMap;
+  /// Key-value pairs of the configuration.
+  arg_table m_argMap;
+
+  /// Typed values parsed from m_argMap, indexed by entry id.
+  typed_cache m_cache;
+
+  /**
+   * Snapshot that m_argMap was loaded from by loadSnapshot(), used to
+   * fill m_cache without parsing. Dropped when the configuration is
+   * reloaded.
+   */
+  std::shared_ptr<const mapped_image> m_snapshot;
 
   /**
    * When this is true, config keys and options are checked against
@@ -206,8 +955,9 @@ private:
    */
   bool m_checkKeys;
 
-  std::unordered_set<std::string> m_validKeys;
-  std::unordered_set<std::string> m_validOptions;
+  /// Valid keys and options (only the keys of these tables are used).
+  arg_table m_validKeys;
+  arg_table m_validOptions;
 
   /// File path that was passed to initFile(), or an empty string.
   std::string m_filePath;
@@ -218,10 +968,21 @@ private:
    */
   std::string m_fileName;
 
-	// ---------- Constants ----------
+  /// Every file loaded into m_argMap, stamped by saveSnapshot().
+  std::vector<std::string> m_sourceFiles;
+
+  /**
+   * Index in m_sourceFiles of the file each entry was read from (an
+   * included file rather than the file including it), or NO_SOURCE.
+   */
+  std::vector<uint32_t> m_entrySources;
 
-	/// Regex defining the syntax of a <key>=<value> expression.
-	static const std::string keyValRegex;
+  /**
+   * Values stored by interpolate() that contain a literal "${", by
+   * entry id. They are not expanded again until the entry is set again
+   * (see setEntry()).
+   */
+  std::map<arg_table::id_type, std::string> m_literalRefs;
 };
 
 #endif
@@ -0,0 +1,51 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef _config_diff_hpp_
+#define _config_diff_hpp_
+
+#include "config.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * The keys added, removed and changed (with a different value) from
+ * one configuration to another, for instance between two versions
+ * published by a config_reloader. Each list of keys is sorted, so the
+ * keys under a prefix ("solver." for instance) are contiguous.
+ *
+ * The diff is computed in time linear in the number of keys: each key
+ * of one configuration is looked up in the hash table of the other.
+ */
+class config_diff {
+
+public:
+
+  /// An empty diff.
+  config_diff() {}
+
+  /// Computes the changes from "before" to "after".
+  config_diff(const config& before, const config& after);
+
+  const std::vector<std::string>& added() const { return m_added; }
+  const std::vector<std::string>& removed() const { return m_removed; }
+  const std::vector<std::string>& changed() const { return m_changed; }
+
+  /// Returns true if no key was added, removed or changed.
+  bool empty() const { return m_added.empty() && m_removed.empty() && m_changed.empty(); }
+
+  /// Returns true if a key starting with "prefix" was added, removed or changed.
+  bool affects(std::string_view prefix) const;
+
+  /// Returns the changes to the keys starting with "prefix".
+  config_diff filter(std::string_view prefix) const;
+
+private:
+
+  std::vector<std::string> m_added;
+  std::vector<std::string> m_removed;
+  std::vector<std::string> m_changed;
+};
+
+#endif
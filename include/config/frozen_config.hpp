@@ -0,0 +1,254 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef _frozen_config_hpp_
+#define _frozen_config_hpp_
+
+#include "config.hpp"
+#include "array_view.hpp"
+#include "private/ConfigImage.hpp"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Immutable copy of a configuration, obtained from config::freeze().
+ *
+ * Every value is parsed when the configuration is frozen (numbers,
+ * lists and sequences) and stored in a single read-only block with the
+ * same layout as a snapshot (see ConfigImage.hpp), so getters only
+ * look up the key and read the stored value. Nothing is modified,
+ * cached or allocated by the getters (except where they return a
+ * std::string or fill a vector), so all methods can be called from
+ * any number of threads without synchronization. The exception is
+ * array references ("@file:<path>", see config::getDoubleArray()),
+ * which are stored as references: the list getters map the file and
+ * convert its elements the first time they are called, under a lock.
+ * A frozen_config is meant to be shared through a
+ * std::shared_ptr<const frozen_config>.
+ *
+ * Lists are returned as array_views of the stored elements, which
+ * remain valid for the lifetime of the frozen_config, and sequences as
+ * seq_ranges.
+ *
+ * Since the image holds no pointers, it can also be shared between
+ * processes: publish() copies it into a named POSIX shared memory
+ * object, and attach() returns a frozen_config that reads it in place,
+ * so that the processes of a node share a single copy of the keys,
+ * values and parsed lists.
+ */
+class frozen_config {
+
+public:
+
+  /**
+   *@throws key_not_found  If the specified key does not exist.
+   */
+  uint   parseParamUInt(std::string_view key) const;
+
+  double parseParamDouble(std::string_view key) const;
+
+  bool   parseParamBool(std::string_view key) const;
+
+  std::string getParamString(std::string_view key) const;
+
+  std::string_view getParamView(std::string_view key) const;
+
+  bool checkOption(std::string_view key) const;
+
+  bool keyExists(std::string_view key) const;
+
+  /// Same as the corresponding config methods.
+  bool sequenceParser(std::string_view key, std::vector<uint>& seqReturn) const;
+  bool sequenceParser(std::string_view key, std::vector<double>& seqReturn) const;
+  bool listParser(std::string_view key, std::vector<int>& listReturn) const;
+  bool listParser(std::string_view key, std::vector<double>& listReturn) const;
+  bool listParser(std::string_view key, std::vector<std::string>& listReturn) const;
+
+  /**
+   * Returns the sequence described by the value of "key", as a range
+   * whose elements are computed on access. Same as
+   * config::getUIntRange() and config::getDoubleRange() (there is no
+   * equivalent of config::getUIntSequence(), which builds a vector).
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid sequence.
+   */
+  seq_range<uint>   getUIntRange(std::string_view key) const;
+  seq_range<double> getDoubleRange(std::string_view key) const;
+
+  /**
+   * Returns the elements of the list described by the value of "key".
+   *@throws key_not_found     If the specified key does not exist.
+   *@throws syntax_exception  If the value is not a valid list.
+   */
+  array_view<int>    getIntList(std::string_view key) const;
+  array_view<double> getDoubleList(std::string_view key) const;
+  array_view<std::string_view> getStringList(std::string_view key) const;
+
+  /**
+   * Returns a handle for "key". Handles resolved on the config object
+   * before it was frozen can also be used.
+   *@throws key_not_found  If the specified key does not exist.
+   */
+  config::handle resolve(std::string_view key) const;
+
+  // The getters taking a handle throw key_not_found if the handle is
+  // invalid, or does not refer to a key of this configuration.
+
+  uint   parseParamUInt(config::handle h) const;
+  double parseParamDouble(config::handle h) const;
+  bool   parseParamBool(config::handle h) const;
+  std::string_view getParamView(config::handle h) const;
+  seq_range<uint>    getUIntRange(config::handle h) const;
+  seq_range<double>  getDoubleRange(config::handle h) const;
+  array_view<int>    getIntList(config::handle h) const;
+  array_view<double> getDoubleList(config::handle h) const;
+  array_view<std::string_view> getStringList(config::handle h) const;
+
+  /// Number of keys in the configuration.
+  size_t size() const { return m_view.size(); }
+
+  std::string getFilePath() const { return m_filePath; }
+
+  std::string getFileName() const { return m_fileName; }
+
+  /**
+   * Publishes the image of the configuration as the POSIX shared
+   * memory object "name" (of the form "/<name>"; a leading '/' is
+   * added if missing), replacing any object of that name. Processes
+   * already attached to the previous object keep reading it; the
+   * object is removed from the system by unpublish() (or at reboot).
+   * The image is complete before the object can be attached.
+   *@throws file_exception  If the object cannot be created or written.
+   */
+  void publish(std::string name) const;
+
+  /**
+   * Returns a frozen_config that reads the image published as "name"
+   * in place, without copying or parsing it. The object remains mapped
+   * for the lifetime of the returned frozen_config.
+   *@throws file_exception      If the object cannot be opened or mapped.
+   *@throws snapshot_exception  If the object does not hold a complete
+   *                            image of this version of the library.
+   */
+  static std::shared_ptr<const frozen_config> attach(std::string name);
+
+  /**
+   * Removes the shared memory object "name". Attached processes are
+   * not affected.
+   *@return 'false' if there is no such object.
+   */
+  static bool unpublish(std::string name);
+
+private:
+
+  friend class config;
+
+  /**
+   * Takes ownership of an image built by config::freeze().
+   */
+  explicit frozen_config(std::vector<char> image);
+
+  /// Used by attach(), which maps the image into m_mapping.
+  frozen_config() {}
+
+  /**
+   * Attaches m_view to the image at "data".
+   *@throws snapshot_exception  If "data" does not hold a valid image
+   *                            ("name" is reported).
+   */
+  void init(const char* data, size_t size, const std::string& name);
+
+  /// Fills m_strings and m_stringListStart.
+  void indexStrings() const;
+
+  frozen_config(const frozen_config&);
+  frozen_config& operator=(const frozen_config&);
+
+  /**
+   * Returns the id of the entry for "key".
+   *@throws key_not_found  If the specified key does not exist.
+   */
+  arg_table::id_type lookup(std::string_view key) const;
+
+  /**
+   * Checks that "h" refers to an entry of this configuration.
+   *@throws key_not_found  If it does not (e.g. a default handle).
+   */
+  void checkHandle(config::handle h) const {
+    if(h.m_id >= m_view.size()) throw key_not_found("(invalid handle)");
+  }
+
+  /**
+   * Returns the elements of kind "k" of entry "id".
+   *@throws syntax_exception  If the value is not a valid list of that
+   *                          kind.
+   */
+  template<class T>
+  array_view<T> array(arg_table::id_type id, typed_cache::kind k) const;
+
+  /**
+   * Elements of the array file referenced by an entry, converted to
+   * each type of list the first time that type is requested.
+   */
+  struct referenced_lists {
+    std::vector<int> ints;
+    std::vector<double> doubles;
+    std::vector<std::string> strings;
+    std::vector<std::string_view> views;
+    std::once_flag intsConverted;
+    std::once_flag doublesConverted;
+    std::once_flag stringsConverted;
+  };
+
+  /// Returns the (possibly not yet converted) lists of entry "id".
+  referenced_lists& referenced(arg_table::id_type id) const;
+
+  /**
+   * Path of the file that entry "id" was read from, against which its
+   * relative "@file:" references are resolved (m_filePath if none).
+   */
+  std::string sourcePathOf(arg_table::id_type id) const;
+
+  /**
+   * Returns the elements of the array file referenced by entry "id",
+   * converted to T.
+   *@throws syntax_exception, file_exception  See array_file.
+   */
+  template<class T>
+  array_view<T> referencedArray(arg_table::id_type id,
+                                std::vector<T> referenced_lists::* elems,
+                                std::once_flag referenced_lists::* converted) const;
+
+  array_view<std::string_view> referencedStrings(arg_table::id_type id) const;
+
+  // ---------- Data Members ----------
+
+  /// The image, held in either of these (see attach()).
+  std::vector<char> m_image;
+  file_mapping m_mapping;
+
+  image_view m_view;
+
+  /**
+   * Elements of all the string lists, pointing into the image, and
+   * index in m_strings of the first element of each entry's list.
+   * They are only built by the first call to getStringList(), since
+   * this index is not shared between attached processes.
+   */
+  mutable std::vector<std::string_view> m_strings;
+  mutable std::vector<size_t> m_stringListStart;
+  mutable std::once_flag m_stringsIndexed;
+
+  /// Lists of the entries that reference array files, by entry id.
+  mutable std::map<arg_table::id_type, std::unique_ptr<referenced_lists>> m_referenced;
+  mutable std::mutex m_referencedMutex;
+
+  std::string m_filePath;
+  std::string m_fileName;
+};
+
+#endif
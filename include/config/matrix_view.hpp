@@ -0,0 +1,63 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef _matrix_view_hpp_
+#define _matrix_view_hpp_
+
+#include "array_view.hpp"
+#include <cstddef>
+
+/**
+ * Read-only view of a multi-dimensional array of numbers stored
+ * contiguously in row-major order (the last index varies fastest), as
+ * parsed from a nested list "{{1, 2, 3}, {4, 5, 6}}" (see
+ * config::getDoubleMatrix()). The shape gives the size of each
+ * dimension, the outermost first: {2, 3} in this example.
+ */
+template<class T>
+class matrix_view {
+
+public:
+
+  typedef T value_type;
+
+  matrix_view() : m_data(0), m_shape(0), m_rank(0), m_size(0) {}
+
+  matrix_view(const T* data, const size_t* shape, size_t rank)
+    : m_data(data), m_shape(shape), m_rank(rank), m_size(rank > 0 ? 1 : 0) {
+    for(size_t i=0; i<rank; i++) m_size *= shape[i];
+  }
+
+  /// The elements, in row-major order.
+  const T* data() const { return m_data; }
+
+  /// Total number of elements.
+  size_t size() const { return m_size; }
+
+  /// Number of dimensions.
+  size_t rank() const { return m_rank; }
+
+  /// Size of each dimension, the outermost first.
+  array_view<size_t> shape() const { return array_view<size_t>(m_shape, m_rank); }
+
+  /// Size of dimension "i".
+  size_t dim(size_t i) const { return m_shape[i]; }
+
+  /// For a matrix (rank 2): number of rows and columns.
+  size_t rows() const { return m_shape[0]; }
+  size_t cols() const { return m_shape[1]; }
+
+  /// For a matrix (rank 2): the element at row "i" and column "j".
+  const T& operator()(size_t i, size_t j) const { return m_data[i * m_shape[1] + j]; }
+
+  /// The elements as a flat array.
+  array_view<T> elements() const { return array_view<T>(m_data, m_size); }
+
+private:
+  const T* m_data;
+  const size_t* m_shape;
+  size_t m_rank;
+  size_t m_size;
+};
+
+#endif
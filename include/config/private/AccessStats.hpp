@@ -0,0 +1,134 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef AccessStats_hpp_
+#define AccessStats_hpp_
+
+#include "ArgTable.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Per-entry access statistics of a config, recorded when the library
+ * is compiled with CONFIG_INSTRUMENTATION defined (see the
+ * CONFIG_INSTRUMENTATION option of CMakeLists.txt). Without it, the
+ * CONFIG_COUNT_ACCESS and CONFIG_TIME_PARSE hooks expand to nothing
+ * and config holds no statistics.
+ *
+ * Counters are updated with relaxed atomic operations, so that
+ * getters remain safe to call concurrently. grow() must not be called
+ * concurrently with updates.
+ */
+class access_stats {
+
+public:
+
+  /// The getters whose calls are counted.
+  enum getter {
+    PARSE_UINT, PARSE_DOUBLE, PARSE_BOOL,
+    GET_STRING, GET_VIEW, CHECK_OPTION, KEY_EXISTS, RESOLVE,
+    RANGE, SEQUENCE, LIST, LIST_SIZE, ARRAY, MATRIX,
+    NB_GETTERS
+  };
+
+  /// Name of a getter (or family of getters) in reports.
+  static const char* getterName(getter g);
+
+  access_stats() {}
+
+  /// Copies the size of the statistics, but none of the counts.
+  access_stats(const access_stats& other) : m_entries(other.m_entries.size()) {}
+
+  access_stats& operator=(const access_stats& other) {
+    std::vector<entry>(other.m_entries.size()).swap(m_entries);
+    return *this;
+  }
+
+  /**
+   * Makes room for "nbEntries" entries, keeping the counts of the
+   * existing ones (entry ids are stable).
+   */
+  void grow(size_t nbEntries) {
+    if(nbEntries > m_entries.size()) m_entries.resize(nbEntries);
+  }
+
+  void countAccess(arg_table::id_type id, getter g) const {
+    m_entries[id].lookups[g].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void addParseTime(arg_table::id_type id, uint64_t ns) const {
+    m_entries[id].parseNs.fetch_add(ns, std::memory_order_relaxed);
+    m_entries[id].nbParses.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Statistics of one key, as reported by config::accessReport().
+  struct key_access {
+    std::string key;
+    /// Number of calls of each getter.
+    uint64_t lookups[NB_GETTERS];
+    /// Sum of "lookups".
+    uint64_t totalLookups;
+    /// Time spent parsing or copying the value, in nanoseconds.
+    uint64_t parseNs;
+    /// Number of timed parses or copies.
+    uint64_t nbParses;
+  };
+
+  /// Fills the counts of entry "id" into "access".
+  void read(arg_table::id_type id, key_access& access) const;
+
+  size_t size() const { return m_entries.size(); }
+
+  /**
+   * Adds the time elapsed between its construction and its
+   * destruction to the parse time of an entry.
+   */
+  class parse_timer {
+  public:
+    parse_timer(const access_stats& stats, arg_table::id_type id)
+      : m_stats(stats), m_id(id), m_start(std::chrono::steady_clock::now()) {}
+
+    ~parse_timer() {
+      std::chrono::steady_clock::duration d = std::chrono::steady_clock::now() - m_start;
+      m_stats.addParseTime(m_id, std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+
+  private:
+    const access_stats& m_stats;
+    arg_table::id_type m_id;
+    std::chrono::steady_clock::time_point m_start;
+  };
+
+private:
+
+  struct entry {
+    entry() : parseNs(0), nbParses(0) {
+      for(int g=0; g<NB_GETTERS; g++) lookups[g] = 0;
+    }
+    entry(entry&& other)
+      : parseNs(other.parseNs.load(std::memory_order_relaxed)),
+        nbParses(other.nbParses.load(std::memory_order_relaxed)) {
+      for(int g=0; g<NB_GETTERS; g++)
+        lookups[g] = other.lookups[g].load(std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> lookups[NB_GETTERS];
+    std::atomic<uint64_t> parseNs;
+    std::atomic<uint64_t> nbParses;
+  };
+
+  mutable std::vector<entry> m_entries;
+};
+
+#ifdef CONFIG_INSTRUMENTATION
+#define CONFIG_COUNT_ACCESS(stats, id, g) (stats).countAccess(id, access_stats::g)
+#define CONFIG_TIME_PARSE(stats, id) access_stats::parse_timer configParseTimer_((stats), (id))
+#else
+#define CONFIG_COUNT_ACCESS(stats, id, g) ((void)0)
+#define CONFIG_TIME_PARSE(stats, id) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,156 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef ArgTable_hpp_
+#define ArgTable_hpp_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * Storage for the key-value pairs of a configuration. All key and
+ * value bytes live in a single arena, entries are stored densely in
+ * insertion order, and keys are indexed by an open-addressing hash
+ * table. Copying an arg_table therefore copies a few contiguous
+ * blocks instead of one heap node per key, and lookups take a
+ * std::string_view without allocating.
+ *
+ * Entries are never removed, so an entry id remains valid (and keeps
+ * referring to the same key) for the lifetime of the table. Keys and
+ * values are null-terminated in the arena, so the data() pointer of
+ * the views returned by key() and value() is a valid c-string.
+ *
+ * A replaced value reuses the bytes of the previous one when it fits.
+ * Otherwise it is appended, and the arena is compacted when more than
+ * half of it is unused, so that repeated overrides do not make it
+ * grow without bound. Views of the keys and values are therefore
+ * invalidated by set().
+ */
+class arg_table {
+
+public:
+
+  typedef uint32_t id_type;
+
+  /// Id returned when a key is not found.
+  static constexpr id_type npos = 0xFFFFFFFF;
+
+  arg_table() : m_mask(0), m_unusedBytes(0) {}
+
+  /**
+   * Returns the id of the entry associated with "key", or npos if
+   * the key does not exist.
+   */
+  id_type find(std::string_view key) const;
+
+  /**
+   * Associates "val" with "key". If the key already exists, its value
+   * is replaced only when "overwrite" is true.
+   *@return The id of the entry associated with "key".
+   *@throws std::length_error  If "key" or "val" is longer than
+   *                           UINT32_MAX bytes, or if the table is full.
+   */
+  id_type set(std::string_view key, std::string_view val, bool overwrite = true);
+
+  std::string_view key(id_type id) const {
+    const entry& e = m_entries[id];
+    return std::string_view(m_arena.data() + e.keyOff, e.keyLen);
+  }
+
+  std::string_view value(id_type id) const {
+    const entry& e = m_entries[id];
+    return std::string_view(m_arena.data() + e.valOff, e.valLen);
+  }
+
+  /// Number of entries (keys) in the table.
+  size_t size() const { return m_entries.size(); }
+
+  /// Number of bytes used by the arena, including unused ones.
+  size_t arenaSize() const { return m_arena.size(); }
+
+  /**
+   * Pre-allocates room for "nbEntries" entries and "nbBytes" bytes of
+   * key and value data.
+   */
+  void reserve(size_t nbEntries, size_t nbBytes);
+
+  /**
+   * Slot of the hash index. The tag holds the high bits of the key's
+   * hash, so that probing rarely needs to compare the key bytes.
+   */
+  struct slot {
+    id_type  id;
+    uint32_t tag;
+  };
+
+  /// Location of a key and of its value in the arena.
+  struct entry {
+    uint64_t keyOff;
+    uint64_t valOff;
+    uint32_t keyLen;
+    uint32_t valLen;
+  };
+
+  /**
+   * Replaces the content of the table with raw blocks previously
+   * obtained from another table (see image_builder).
+   */
+  void assign(const char* arena, size_t arenaSize,
+              const entry* entries, size_t nbEntries,
+              const slot* slots, size_t nbSlots);
+
+  /**
+   * Looks up "key" in an index made of raw blocks laid out like the
+   * ones of an arg_table. Used by find() and by image_view.
+   */
+  static id_type find(std::string_view key, const slot* slots, size_t mask,
+                      const entry* entries, const char* arena);
+
+  /**
+   * The hash function used by the index. Images written by
+   * image_builder depend on it: changing it requires a new image
+   * version. It is 64 bits wide on every platform: the low bits select
+   * the slot, and the high 32 bits are the slot's tag.
+   */
+  static uint64_t hash(std::string_view s);
+
+private:
+
+  friend class image_builder;
+
+  /**
+   * Copies "s" followed by a null character at the end of the arena
+   * and returns its offset.
+   */
+  uint64_t append(std::string_view s);
+
+  /// Replaces the value of entry "id" by "val".
+  void replaceValue(id_type id, std::string_view val);
+
+  /// Copies the keys and values into a new arena without unused bytes.
+  void compact();
+
+  /// Rebuilds the hash index with "nbSlots" slots (a power of 2).
+  void rehash(size_t nbSlots);
+
+  // ---------- Data Members ----------
+
+  /// Key and value bytes.
+  std::vector<char> m_arena;
+
+  /// Entries in insertion order. An entry's index is its id.
+  std::vector<entry> m_entries;
+
+  /// Open-addressing (linear probing) index of entry ids.
+  std::vector<slot> m_slots;
+
+  /// m_slots.size()-1
+  size_t m_mask;
+
+  /// Bytes of the arena that belong to replaced values.
+  size_t m_unusedBytes;
+};
+
+#endif
@@ -0,0 +1,94 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef ArrayFile_hpp_
+#define ArrayFile_hpp_
+
+#include "FileMapping.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * A raw array of numbers stored in a separate file, referenced by a
+ * value of the form "@file:<path>". The type of the elements is given
+ * by the extension of the file:
+ *
+ *   .f64  double    .f32  float    .i64  int64_t    .i32  int32_t
+ *
+ * Elements are stored in little-endian byte order, without any header.
+ * The file is memory-mapped read-only, so that its elements are used
+ * in place (and shared through the page cache by every process that
+ * maps it).
+ */
+class array_file {
+
+public:
+
+  enum elem_type { F64, F32, I64, I32, INVALID };
+
+  /**
+   * Returns true if "val" is a reference to an array file.
+   */
+  static bool isReference(std::string_view val) {
+    return val.compare(0, PREFIX.size(), PREFIX) == 0;
+  }
+
+  /**
+   * Returns the path of the file referenced by "val", resolved
+   * relative to the directory of "configPath" (the file the value was
+   * loaded from) unless it is absolute.
+   */
+  static std::string resolvePath(std::string_view val, const std::string& configPath);
+
+  /// Returns the type of the elements of an array file with path "path".
+  static elem_type typeOf(std::string_view path);
+
+  static size_t elemSize(elem_type t);
+
+  /**
+   * Maps the array file at "path".
+   *@throws syntax_exception  If the extension does not name an element type.
+   *@throws file_exception    If the file cannot be mapped, or its size is
+   *                          not a multiple of the size of an element.
+   */
+  explicit array_file(const std::string& path);
+
+  elem_type type() const { return m_type; }
+
+  /// Number of elements.
+  size_t size() const { return m_size; }
+
+  /**
+   * Pointer to the elements. The host must use the same type ("T" must
+   * correspond to type()).
+   */
+  template<class T>
+  const T* data() const { return reinterpret_cast<const T*>(m_file.data()); }
+
+  /**
+   * Converts the first "n" elements to T and writes them to "out".
+   * Conversions to int saturate at INT_MIN and INT_MAX, and NaN
+   * converts to 0.
+   */
+  void copyTo(int* out, size_t n) const;
+  void copyTo(double* out, size_t n) const;
+
+  /// Formats each element as a string (see std::to_chars).
+  void copyTo(std::vector<std::string>& out) const;
+
+  static const std::string_view PREFIX;
+
+private:
+
+  template<class T>
+  void convert(T* out, size_t n) const;
+
+  file_mapping m_file;
+  elem_type m_type;
+  size_t m_size;
+};
+
+#endif
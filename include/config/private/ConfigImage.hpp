@@ -0,0 +1,287 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef ConfigImage_hpp_
+#define ConfigImage_hpp_
+
+#include "ArgTable.hpp"
+#include "FileMapping.hpp"
+#include "TypedCache.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Binary image of a configuration: the key index, the raw key-value
+ * pairs and the typed values pre-parsed from them, stored in one
+ * position-independent block (all references are offsets) that can be
+ * written to a file and memory-mapped. Sections are 8-byte aligned:
+ *
+ *   image_header
+ *   arg_table::slot   [nbSlots]      hash index
+ *   arg_table::entry  [nbEntries]
+ *   char              [arenaSize]    key and value bytes
+ *   typed_record      [nbEntries]
+ *   char              [payloadSize]  list elements, source path,
+ *                                    source stamps and their paths
+ */
+
+/// Version of the image format. Must be increased whenever the layout
+/// or arg_table::hash() changes.
+#define CONFIG_IMAGE_VERSION 4
+
+/// Number of list kinds in typed_cache::kind.
+#define CONFIG_IMAGE_NBLISTS (typed_cache::LIST_STRING - typed_cache::LIST_INT + 1)
+
+struct image_header {
+  char     magic[8];
+  uint32_t version;
+  /// 0x01020304 in the byte order of the producer.
+  uint32_t byteOrder;
+  uint64_t totalSize;
+  uint64_t nbEntries;
+  uint64_t nbSlots;
+  uint64_t slotsOff;
+  uint64_t entriesOff;
+  uint64_t arenaOff;
+  uint64_t arenaSize;
+  uint64_t recordsOff;
+  uint64_t payloadOff;
+  uint64_t payloadSize;
+
+  // file the configuration was loaded from (empty path if none)
+  uint64_t sourcePathOff;
+  uint64_t sourcePathLen;
+  // version of every file whose content is in the image (image_stamp)
+  uint64_t stampsOff;
+  uint64_t nbStamps;
+};
+
+/**
+ * Version of one source file, as stored in the payload.
+ */
+struct image_stamp {
+  uint64_t pathOff;
+  uint64_t pathLen;
+  int64_t  mtimeSec;
+  int64_t  mtimeNsec;
+  uint64_t size;
+  uint64_t hash;
+};
+
+/**
+ * Typed values pre-parsed from one entry. A value-initialized record
+ * (e.g. an element of a new vector) is zero-filled, padding included.
+ */
+struct typed_record {
+  /// Value of "source" for an entry that was not read from a file.
+  static constexpr uint32_t NO_SOURCE = 0xFFFFFFFF;
+
+  /// Bit k is set if the value of typed_cache::kind k is stored.
+  uint32_t present = 0;
+  /// Bit k is set if the list or range of kind k has valid syntax.
+  uint32_t valid = 0;
+  uint32_t uintVal = 0;
+  uint32_t boolVal = 0;
+  /// Index of the stamp of the file the entry was read from, or NO_SOURCE.
+  uint32_t source = NO_SOURCE;
+  double   doubleVal = 0;
+  /**
+   * Payload offset and number of elements of each list, indexed by
+   * (kind - typed_cache::LIST_INT). The elements of string lists are
+   * stored as consecutive (uint32 length, bytes) items.
+   */
+  uint64_t listOff[CONFIG_IMAGE_NBLISTS] = {};
+  uint64_t listLen[CONFIG_IMAGE_NBLISTS] = {};
+  /// Sequences are stored as ranges, not as elements.
+  seq_range<uint>   uintRange;
+  seq_range<double> doubleRange;
+};
+
+/**
+ * Identifies the version of a source file.
+ */
+struct image_source {
+  image_source() : mtimeSec(0), mtimeNsec(0), size(0), hash(0) {}
+
+  std::string path;
+  int64_t  mtimeSec;
+  int64_t  mtimeNsec;
+  uint64_t size;
+  /// Hash of the content of the file.
+  uint64_t hash;
+
+  /**
+   * Fills "info" for the file at "path". The content is only read
+   * (to compute the hash) if "withHash" is true.
+   *@return 'false' if the file cannot be read.
+   */
+  static bool stat(const std::string& path, image_source& info, bool withHash);
+};
+
+/**
+ * Builds the image of an arg_table and of the typed values parsed
+ * from its entries.
+ */
+class image_builder {
+
+public:
+
+  explicit image_builder(const arg_table& table);
+
+  void setScalars(arg_table::id_type id, uint uintVal, double doubleVal, bool boolVal);
+
+  /**
+   * Stores the list of kind "k" of entry "id".
+   */
+  void setList(arg_table::id_type id, typed_cache::kind k, const parsed_list<int>& list);
+  void setList(arg_table::id_type id, typed_cache::kind k, const parsed_list<double>& list);
+  void setList(arg_table::id_type id, typed_cache::kind k, const parsed_list<std::string>& list);
+
+  /// Stores the sequence of entry "id".
+  void setRange(arg_table::id_type id, const parsed_range<uint>& range);
+  void setRange(arg_table::id_type id, const parsed_range<double>& range);
+
+  /// Records that entry "id" was read from the file of stamp "source".
+  void setSource(arg_table::id_type id, uint32_t source) { m_records[id].source = source; }
+
+  /// Sets the path returned by image_view::sourcePath().
+  void setSourcePath(const std::string& path) { m_sourcePath = path; }
+
+  /**
+   * Records the version of a file whose content is in the image (see
+   * image_view::isFresh()). A stamp with only a path (as stored by
+   * config::freeze()) identifies the file without its version.
+   */
+  void addStamp(const image_source& source) { m_stamps.push_back(source); }
+
+  /// Returns the complete image.
+  std::vector<char> finish() const;
+
+private:
+
+  template<class T>
+  void setNumericList(arg_table::id_type id, typed_cache::kind k, const parsed_list<T>& list);
+
+  /// Appends "n" bytes to the payload (8-byte aligned) and returns their offset.
+  uint64_t appendPayload(const void* data, size_t n);
+
+  const arg_table& m_table;
+  std::vector<typed_record> m_records;
+  std::vector<char> m_payload;
+  std::string m_sourcePath;
+  std::vector<image_source> m_stamps;
+};
+
+/**
+ * Read-only access to an image stored in memory (typically a mapped
+ * file). The view does not own the memory.
+ */
+class image_view {
+
+public:
+
+  image_view() : m_data(0), m_header(0) {}
+
+  /**
+   * Attaches the view to the image at "data", after checking its
+   * header and the bounds of its sections.
+   *@return 'false' if "data" does not hold a valid image.
+   */
+  bool attach(const char* data, size_t size);
+
+  const image_header& header() const { return *m_header; }
+
+  size_t size() const { return m_header->nbEntries; }
+
+  arg_table::id_type find(std::string_view key) const {
+    if(m_header->nbSlots == 0) return arg_table::npos;
+    return arg_table::find(key, slots(), m_header->nbSlots - 1, entries(), arena());
+  }
+
+  std::string_view key(arg_table::id_type id) const {
+    const arg_table::entry& e = entries()[id];
+    return std::string_view(arena() + e.keyOff, e.keyLen);
+  }
+
+  std::string_view value(arg_table::id_type id) const {
+    const arg_table::entry& e = entries()[id];
+    return std::string_view(arena() + e.valOff, e.valLen);
+  }
+
+  const typed_record& record(arg_table::id_type id) const {
+    return reinterpret_cast<const typed_record*>(m_data + m_header->recordsOff)[id];
+  }
+
+  /**
+   * Returns the elements of the numeric list of kind "k" of entry
+   * "id", which must be stored in the image.
+   */
+  template<class T>
+  const T* array(arg_table::id_type id, typed_cache::kind k, size_t& n) const {
+    const typed_record& r = record(id);
+    n = r.listLen[k - typed_cache::LIST_INT];
+    return reinterpret_cast<const T*>(payload() + r.listOff[k - typed_cache::LIST_INT]);
+  }
+
+  /// Copies the list of kind "k" of entry "id" into "list".
+  void getList(arg_table::id_type id, typed_cache::kind k, parsed_list<int>& list) const;
+  void getList(arg_table::id_type id, typed_cache::kind k, parsed_list<double>& list) const;
+  void getList(arg_table::id_type id, typed_cache::kind k, parsed_list<std::string>& list) const;
+
+  /// Copies the sequence of entry "id" into "range".
+  void getRange(arg_table::id_type id, parsed_range<uint>& range) const;
+  void getRange(arg_table::id_type id, parsed_range<double>& range) const;
+
+  std::string_view sourcePath() const {
+    return std::string_view(payload() + m_header->sourcePathOff, m_header->sourcePathLen);
+  }
+
+  size_t nbStamps() const { return m_header->nbStamps; }
+
+  const image_stamp& stamp(size_t i) const {
+    return reinterpret_cast<const image_stamp*>(payload() + m_header->stampsOff)[i];
+  }
+
+  std::string_view stampPath(size_t i) const {
+    return std::string_view(payload() + stamp(i).pathOff, stamp(i).pathLen);
+  }
+
+  /**
+   * Returns true if every source file recorded in the image still has
+   * the same content. A file whose modification time and size are
+   * unchanged is not read.
+   */
+  bool isFresh() const;
+
+  const arg_table::slot* slots() const {
+    return reinterpret_cast<const arg_table::slot*>(m_data + m_header->slotsOff);
+  }
+
+  const arg_table::entry* entries() const {
+    return reinterpret_cast<const arg_table::entry*>(m_data + m_header->entriesOff);
+  }
+
+  const char* arena() const { return m_data + m_header->arenaOff; }
+
+  const char* payload() const { return m_data + m_header->payloadOff; }
+
+private:
+
+  template<class T>
+  void getNumericList(arg_table::id_type id, typed_cache::kind k, parsed_list<T>& list) const;
+
+  const char* m_data;
+  const image_header* m_header;
+};
+
+/**
+ * An image mapped from a file, such as a snapshot.
+ */
+struct mapped_image {
+  file_mapping file;
+  image_view view;
+};
+
+#endif
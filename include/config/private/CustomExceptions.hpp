@@ -5,9 +5,19 @@
 #include <string>
 #include <sstream>
 
+/**
+ * Formats the location of an error in a configuration file as
+ * "<filepath>:<lineNumber>". An error outside of any file (on the
+ * command line) has an empty location.
+ */
+inline std::string errorLocation(const std::string& filepath, size_t lineNumber) {
+  if(filepath.empty()) return "";
+  return filepath + ":" + std::to_string(lineNumber);
+}
+
 class key_not_found : public std::exception {
 public:
-  key_not_found(std::string& keyName)
+  key_not_found(const std::string& keyName)
     : m_keyName(keyName) {}
 
   //note: the exception specification "throw()" is required because it
@@ -22,42 +32,92 @@ private:
 
 class syntax_exception : public std::exception {
 public:
-  syntax_exception(std::string& offender)
+  syntax_exception(const std::string& offender)
     : m_offender(offender) {}
 
+  /// Error at line "lineNumber" of the configuration file "sourcePath".
+  syntax_exception(const std::string& offender, const std::string& sourcePath, size_t lineNumber)
+    : m_offender(offender), m_location(errorLocation(sourcePath, lineNumber)) {}
+
   ~syntax_exception() throw() {}
 
   const char* what() const throw() { return m_offender.c_str(); }
 
+  /**
+   * Returns "<filepath>:<lineNumber>" if the error occurred while
+   * loading a configuration file, an empty string otherwise.
+   */
+  const std::string& location() const { return m_location; }
+
 private:
   std::string m_offender;
+  std::string m_location;
 };
 
 class file_exception : public std::exception {
 public:
-  file_exception(std::string& filepath)
+  file_exception(const std::string& filepath)
     : m_filepath(filepath) {}
 
+  /**
+   * File "filepath" included (or referenced) at line "lineNumber" of
+   * the configuration file "sourcePath".
+   */
+  file_exception(const std::string& filepath, const std::string& sourcePath, size_t lineNumber)
+    : m_filepath(filepath), m_location(errorLocation(sourcePath, lineNumber)) {}
+
   ~file_exception() throw() {}
 
   /// Returns the filepath of the file that triggered the exception.
   const char* what() const throw() { return m_filepath.c_str(); }
 
+  /**
+   * Returns "<filepath>:<lineNumber>" if the error occurred while
+   * loading a configuration file, an empty string otherwise.
+   */
+  const std::string& location() const { return m_location; }
+
 private:
   std::string m_filepath;
+  std::string m_location;
 };
 
 class invalidkey_exception : public std::exception {
 public:
-  invalidkey_exception(std::string& keyName)
+  invalidkey_exception(const std::string& keyName)
     : m_keyName(keyName) {}
 
+  /// Error at line "lineNumber" of the configuration file "sourcePath".
+  invalidkey_exception(const std::string& keyName, const std::string& sourcePath, size_t lineNumber)
+    : m_keyName(keyName), m_location(errorLocation(sourcePath, lineNumber)) {}
+
   ~invalidkey_exception() throw() {}
 
   const char* what() const throw() { return m_keyName.c_str(); }
 
+  /**
+   * Returns "<filepath>:<lineNumber>" if the error occurred while
+   * loading a configuration file, an empty string otherwise.
+   */
+  const std::string& location() const { return m_location; }
+
 private:
   std::string m_keyName;
+  std::string m_location;
+};
+
+class snapshot_exception : public std::exception {
+public:
+  snapshot_exception(const std::string& filepath)
+    : m_filepath(filepath) {}
+
+  ~snapshot_exception() throw() {}
+
+  /// Returns the filepath of the invalid or stale snapshot.
+  const char* what() const throw() { return m_filepath.c_str(); }
+
+private:
+  std::string m_filepath;
 };
 
 #endif
@@ -0,0 +1,53 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef FileMapping_hpp_
+#define FileMapping_hpp_
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Read-only memory mapping of a whole file (or shared memory object),
+ * unmapped on destruction.
+ */
+class file_mapping {
+
+public:
+
+  file_mapping() : m_data(0), m_size(0) {}
+
+  ~file_mapping() { unmap(); }
+
+  /**
+   * Maps the file at "path". An empty file is mapped successfully,
+   * with data() returning a null pointer.
+   *@return 'false' if the file cannot be opened or mapped.
+   */
+  bool map(const std::string& path);
+
+  /**
+   * Maps the POSIX shared memory object "name" (see shm_open()).
+   *@return 'false' if the object cannot be opened or mapped.
+   */
+  bool mapShared(const std::string& name);
+
+  void unmap();
+
+  const char* data() const { return m_data; }
+
+  size_t size() const { return m_size; }
+
+private:
+
+  /// Maps the open file "fd", and closes it.
+  bool mapFd(int fd);
+
+  file_mapping(const file_mapping&);
+  file_mapping& operator=(const file_mapping&);
+
+  const char* m_data;
+  size_t m_size;
+};
+
+#endif
@@ -0,0 +1,88 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef LineScanner_hpp_
+#define LineScanner_hpp_
+
+#include <cstddef>
+
+/**
+ * Hand-written scanner for the "<key>=<value>" and "--<option>"
+ * grammar accepted by config. Each scan makes a single pass over its
+ * input, never allocates, and reports matches as pointer ranges into
+ * the input buffer.
+ */
+class line_scanner {
+
+public:
+
+  /// A [begin, end) range of characters inside the scanned buffer.
+  struct range {
+    const char* begin;
+    const char* end;
+
+    size_t size() const { return end - begin; }
+  };
+
+  /**
+   * Searches [begin, end) for a "<key>=<value>" expression. The match
+   * is the same as the one previously obtained with the regex
+   * "([[:alpha:][:digit:]_:-]+)[[:space:]]*=[[:space:]]*(.+)".
+   *@param key  Set to the key if a match is found.
+   *@param val  Set to the value if a match is found.
+   *@return 'true' if a match was found, 'false' otherwise.
+   */
+  static bool scanKeyVal(const char* begin, const char* end,
+                         range& key, range& val);
+
+  /**
+   * Searches [begin, end) for an option "--<option>" that extends to
+   * the end of the input (trailing whitespace is allowed). The match
+   * is the same as the one previously obtained with the regex
+   * "--([[:alpha:][:digit:]_-]+)[[:space:]]*$".
+   *@param option  Set to the option name (without "--") if a match is found.
+   *@return 'true' if a match was found, 'false' otherwise.
+   */
+  static bool scanOption(const char* begin, const char* end, range& option);
+
+  /**
+   * Matches a trimmed line "include <path>" of a configuration file.
+   * The path may be enclosed in double quotes. Only lines that are not
+   * a "<key>=<value>" expression can be include directives.
+   *@param path  Set to the path if the line matches.
+   *@return 'true' if the line is an include directive.
+   */
+  static bool scanInclude(const char* begin, const char* end, range& path);
+
+  /**
+   * Removes leading and trailing whitespace from [begin, end).
+   */
+  static void trim(const char*& begin, const char*& end);
+
+  /**
+   * Returns true if the (trimmed) range contains nothing to parse,
+   * i.e. it is empty or is a comment line.
+   */
+  static bool isBlankOrComment(const char* begin, const char* end) {
+    return begin == end || *begin == COMMENT_CHAR;
+  }
+
+  /// Character indicating a line comment.
+  static const char COMMENT_CHAR = '#';
+
+  static bool isSpace(char c) {
+    return c==' ' || c=='\t' || c=='\n' || c=='\v' || c=='\f' || c=='\r';
+  }
+
+  static bool isKeyChar(char c) {
+    return (c>='a' && c<='z') || (c>='A' && c<='Z') || (c>='0' && c<='9') ||
+      c=='_' || c==':' || c=='-';
+  }
+
+  static bool isOptionChar(char c) {
+    return (c>='a' && c<='z') || (c>='A' && c<='Z') || (c>='0' && c<='9') ||
+      c=='_' || c=='-';
+  }
+};
+
+#endif
@@ -0,0 +1,99 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef ListScanner_hpp_
+#define ListScanner_hpp_
+
+#include "LineScanner.hpp"
+#include <cstddef>
+#include <vector>
+
+/**
+ * Hand-written scanner for list values "{<item1>, <item2>, ...}". The
+ * elements are the same as the ones previously obtained by matching
+ * the regex "\{(.+)\}" and splitting its content on ',' with
+ * std::getline (skipping the whitespace before each element), but
+ * they are reported as pointer ranges into the value, and numbers are
+ * converted without building a string per element. Delimiters are
+ * searched 16 bytes at a time with SSE2 when it is available.
+ */
+class list_scanner {
+
+public:
+
+  /**
+   * Finds the content of the list in [begin, end), between the first
+   * '{' and the last '}' on the same line.
+   *@return 'false' if the value is not a list.
+   */
+  static bool findContent(const char* begin, const char* end,
+                          line_scanner::range& content);
+
+  /**
+   * Returns the number of elements in the content of a list, without
+   * parsing them.
+   */
+  static size_t count(const char* begin, const char* end);
+
+  /**
+   * Calls "emit(elemBegin, elemEnd)" for each element in the content
+   * of a list. Leading whitespace is not part of an element, trailing
+   * whitespace is.
+   */
+  template<class Emit>
+  static void forEach(const char* begin, const char* end, Emit emit) {
+    const char* p = skipSpace(begin, end);
+    while(p < end) {
+      const char* comma = findComma(p, end);
+      emit(p, comma);
+      if(comma == end) break;
+      p = skipSpace(comma+1, end);
+    }
+  }
+
+  /**
+   * Parses the content of a list as numbers into "out", which has room
+   * for "capacity" elements.
+   *@return The number of elements in the list. Only the first
+   *        "capacity" ones are written.
+   */
+  static size_t parse(const char* begin, const char* end, int* out, size_t capacity);
+  static size_t parse(const char* begin, const char* end, double* out, size_t capacity);
+
+  /// Maximum number of levels of a nested list (see parseNested()).
+  static const size_t MAX_NESTING = 32;
+
+  /**
+   * Parses a nested list of numbers "{{1, 2}, {3, 4}}", which must be
+   * all of [begin, end) (surrounding whitespace aside), into "values"
+   * in row-major order, and sets "shape" to the size of each level of
+   * nesting. Unlike a flat list, each element must be entirely a
+   * number, all the lists of a level must have the same size, a list
+   * cannot mix numbers and lists, and there are at most MAX_NESTING
+   * levels.
+   *@return 'false' if the value is not a valid, regular nested list
+   *        (in that case "values" and "shape" are empty).
+   */
+  static bool parseNested(const char* begin, const char* end,
+                          std::vector<int>& values, std::vector<size_t>& shape);
+  static bool parseNested(const char* begin, const char* end,
+                          std::vector<double>& values, std::vector<size_t>& shape);
+
+  /**
+   * Converts an element to a number. The result is the same as atoi()
+   * (resp. atof()) on the element: the longest valid prefix is
+   * converted, and 0 is returned if there is none.
+   */
+  static int    toInt(const char* begin, const char* end);
+  static double toDouble(const char* begin, const char* end);
+
+  /// Returns the first ',' in [begin, end), or "end".
+  static const char* findComma(const char* begin, const char* end);
+
+  static const char* skipSpace(const char* p, const char* end) {
+    while(p < end && line_scanner::isSpace(*p)) p++;
+    return p;
+  }
+};
+
+#endif
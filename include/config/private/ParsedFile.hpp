@@ -0,0 +1,111 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef ParsedFile_hpp_
+#define ParsedFile_hpp_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * The key-value pairs and include directives of a configuration file,
+ * in the order of the file, tokenized independently of any config
+ * (keys are not checked against valid keys, and included files are
+ * not read). A file is parsed up to its first line with invalid
+ * syntax, which is recorded so that a config can apply the preceding
+ * items and then report the error, like a sequential parse.
+ * Immutable once built, so that it can be shared between threads and
+ * between loads (see parse_cache).
+ */
+class parsed_file {
+
+public:
+
+  /**
+   * Reads and tokenizes the file at "path".
+   *@throws file_exception  If the file cannot be read.
+   */
+  explicit parsed_file(const std::string& path);
+
+  enum item_kind { PAIR, INCLUDE };
+
+  /// Number of items (before the syntax error, if any).
+  size_t size() const { return m_items.size(); }
+
+  item_kind kind(size_t i) const { return m_items[i].kind; }
+
+  /// Line of item "i" in the file (the first line is 1).
+  size_t lineNumber(size_t i) const { return m_items[i].line; }
+
+  /// The key of a PAIR item, or the path (as written) of an INCLUDE item.
+  std::string_view key(size_t i) const {
+    return std::string_view(m_data.data() + m_items[i].keyOff, m_items[i].keyLen);
+  }
+
+  /// The value of a PAIR item.
+  std::string_view value(size_t i) const {
+    return std::string_view(m_data.data() + m_items[i].valOff, m_items[i].valLen);
+  }
+
+  /// Total size of the keys and values.
+  size_t dataSize() const { return m_data.size(); }
+
+  /// True if the file contains a line with invalid syntax.
+  bool hasSyntaxError() const { return m_hasError; }
+
+  /// The first line with invalid syntax (see hasSyntaxError()).
+  const std::string& errorLine() const { return m_errorLine; }
+
+  /// Line number of errorLine().
+  size_t errorLineNumber() const { return m_errorLineNumber; }
+
+private:
+
+  struct item {
+    uint64_t keyOff;
+    uint64_t valOff;
+    uint32_t keyLen;
+    uint32_t valLen;
+    uint32_t line;
+    item_kind kind;
+  };
+
+  /// Appends an item, copying its strings into m_data.
+  void add(item_kind kind, size_t line, const char* keyBegin, const char* keyEnd,
+           const char* valBegin, const char* valEnd);
+
+  std::vector<char> m_data;
+  std::vector<item> m_items;
+  bool m_hasError;
+  std::string m_errorLine;
+  size_t m_errorLineNumber;
+};
+
+/**
+ * Process-wide cache of parsed files, keyed by path. An entry is
+ * reused as long as the modification time, size and inode of the file
+ * are unchanged. Thread-safe.
+ */
+class parse_cache {
+
+public:
+
+  /**
+   * Returns the parsed content of the file at "path", from the cache
+   * when the file is unchanged.
+   *@throws file_exception  If the file cannot be read.
+   */
+  static std::shared_ptr<const parsed_file> get(const std::string& path);
+
+  /// Drops all the cached files.
+  static void clear();
+
+  /// Number of cached files.
+  static size_t size();
+};
+
+#endif
@@ -0,0 +1,272 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef TypedCache_hpp_
+#define TypedCache_hpp_
+
+#include "ArgTable.hpp"
+#include "AccessStats.hpp"
+#include "../seq_range.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+typedef unsigned int uint;
+
+class array_file;
+
+/**
+ * Result of parsing a value as a list or a sequence.
+ */
+template<class T>
+struct parsed_list {
+  parsed_list() : valid(false) {}
+
+  /// Whether the value had valid syntax.
+  bool valid;
+
+  /// The elements (empty if the syntax is invalid).
+  std::vector<T> values;
+};
+
+/**
+ * Result of parsing a value as a sequence.
+ */
+template<class T>
+struct parsed_range {
+  parsed_range() : valid(false) {}
+
+  /// Whether the value had valid syntax.
+  bool valid;
+
+  /// The elements (empty if the syntax is invalid).
+  seq_range<T> range;
+};
+
+/**
+ * Result of parsing a value as a nested list of numbers.
+ */
+template<class T>
+struct parsed_matrix {
+  parsed_matrix() : valid(false) {}
+
+  /// Whether the value had valid syntax and a regular shape.
+  bool valid;
+
+  /// The elements in row-major order (empty if the value is invalid).
+  std::vector<T> values;
+
+  /// Size of each dimension, the outermost first.
+  std::vector<size_t> shape;
+};
+
+/**
+ * Lazily filled cache of the typed values parsed from the entries of
+ * an arg_table. Each entry is parsed at most once per kind of value.
+ *
+ * Lookups are safe to perform concurrently: a hit costs one atomic
+ * load, and misses are filled under a mutex. reset() and grow() must
+ * not be called concurrently with lookups.
+ */
+class typed_cache {
+
+public:
+
+  /**
+   * The kinds of typed values that can be cached for an entry. SEQ_*
+   * are the elements of the RANGE_* sequences, stored in a vector.
+   * ARRAY is the mapping of an array file (see array_file), and
+   * MATRIX_* a nested list.
+   */
+  enum kind {
+    UINT, DOUBLE, BOOL,
+    LIST_INT, LIST_DOUBLE, LIST_STRING,
+    RANGE_UINT, RANGE_DOUBLE,
+    SEQ_UINT, SEQ_DOUBLE,
+    ARRAY,
+    MATRIX_INT, MATRIX_DOUBLE
+  };
+
+  typed_cache() {}
+
+  /// Copies the size of the cache, but none of the cached values.
+  typed_cache(const typed_cache& other) : m_slots(other.m_slots.size()) {
+#ifdef CONFIG_INSTRUMENTATION
+    m_stats.grow(m_slots.size());
+#endif
+  }
+
+  typed_cache& operator=(const typed_cache& other) {
+#ifdef CONFIG_INSTRUMENTATION
+    m_stats = access_stats();
+#endif
+    reset(other.m_slots.size());
+    return *this;
+  }
+
+  /**
+   * Drops every cached value and sizes the cache for "nbEntries"
+   * entries.
+   */
+  void reset(size_t nbEntries) {
+    std::vector<slot>(nbEntries).swap(m_slots);
+#ifdef CONFIG_INSTRUMENTATION
+    m_stats.grow(nbEntries);
+#endif
+  }
+
+  /**
+   * Makes room for entries added to the table, keeping the values
+   * already cached.
+   */
+  void grow(size_t nbEntries) {
+    m_slots.resize(nbEntries);
+#ifdef CONFIG_INSTRUMENTATION
+    m_stats.grow(nbEntries);
+#endif
+  }
+
+#ifdef CONFIG_INSTRUMENTATION
+  /**
+   * Access statistics of the entries, sized with the cache. Unlike the
+   * cached values, they are kept by reset(), since entry ids remain
+   * valid when a table is reloaded.
+   */
+  const access_stats& stats() const { return m_stats; }
+#endif
+
+  /**
+   * Returns the value of kind "k" cached for entry "id". If it is not
+   * cached yet, "parse" is called with a reference to the storage to
+   * fill.
+   */
+  template<class T, class Parse>
+  const T& get(arg_table::id_type id, kind k, Parse parse) const {
+    slot& s = m_slots[id];
+    uint32_t bit = 1u << k;
+    if(!(s.flags.load(std::memory_order_acquire) & bit)) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if(!(s.flags.load(std::memory_order_relaxed) & bit)) {
+        parse(field<T>(s, k));
+        s.flags.fetch_or(bit, std::memory_order_release);
+      }
+    }
+    return field<T>(s, k);
+  }
+
+private:
+
+  struct vector_values {
+    parsed_range<uint>       rangeUInt;
+    parsed_range<double>     rangeDouble;
+    parsed_list<uint>        seqUInt;
+    parsed_list<double>      seqDouble;
+    parsed_list<int>         listInt;
+    parsed_list<double>      listDouble;
+    parsed_list<std::string> listString;
+    std::shared_ptr<const array_file> array;
+    parsed_matrix<int>       matrixInt;
+    parsed_matrix<double>    matrixDouble;
+  };
+
+  struct slot {
+    slot() : flags(0), uintVal(0), doubleVal(0), boolVal(false) {}
+
+    slot(slot&& other)
+      : flags(other.flags.load(std::memory_order_relaxed)),
+        uintVal(other.uintVal),
+        doubleVal(other.doubleVal),
+        boolVal(other.boolVal),
+        vectors(std::move(other.vectors)) {}
+
+    /// One bit per kind, set once the value of that kind is cached.
+    std::atomic<uint32_t> flags;
+
+    uint   uintVal;
+    double doubleVal;
+    bool   boolVal;
+
+    /// Allocated the first time a list or sequence is cached.
+    std::unique_ptr<vector_values> vectors;
+  };
+
+  /// Returns the storage for the value of kind "k" in "s".
+  template<class T>
+  static T& field(slot& s, kind k);
+
+  mutable std::vector<slot> m_slots;
+
+  mutable std::mutex m_mutex;
+
+#ifdef CONFIG_INSTRUMENTATION
+  access_stats m_stats;
+#endif
+};
+
+template<>
+inline uint& typed_cache::field<uint>(slot& s, kind) { return s.uintVal; }
+
+template<>
+inline double& typed_cache::field<double>(slot& s, kind) { return s.doubleVal; }
+
+template<>
+inline bool& typed_cache::field<bool>(slot& s, kind) { return s.boolVal; }
+
+template<>
+inline parsed_list<uint>& typed_cache::field< parsed_list<uint> >(slot& s, kind) {
+  if(!s.vectors) s.vectors.reset(new vector_values());
+  return s.vectors->seqUInt;
+}
+
+template<>
+inline parsed_list<double>& typed_cache::field< parsed_list<double> >(slot& s, kind k) {
+  if(!s.vectors) s.vectors.reset(new vector_values());
+  return k == SEQ_DOUBLE ? s.vectors->seqDouble : s.vectors->listDouble;
+}
+
+template<>
+inline parsed_list<int>& typed_cache::field< parsed_list<int> >(slot& s, kind) {
+  if(!s.vectors) s.vectors.reset(new vector_values());
+  return s.vectors->listInt;
+}
+
+template<>
+inline parsed_list<std::string>& typed_cache::field< parsed_list<std::string> >(slot& s, kind) {
+  if(!s.vectors) s.vectors.reset(new vector_values());
+  return s.vectors->listString;
+}
+
+template<>
+inline std::shared_ptr<const array_file>&
+typed_cache::field< std::shared_ptr<const array_file> >(slot& s, kind) {
+  if(!s.vectors) s.vectors.reset(new vector_values());
+  return s.vectors->array;
+}
+
+template<>
+inline parsed_range<uint>& typed_cache::field< parsed_range<uint> >(slot& s, kind) {
+  if(!s.vectors) s.vectors.reset(new vector_values());
+  return s.vectors->rangeUInt;
+}
+
+template<>
+inline parsed_range<double>& typed_cache::field< parsed_range<double> >(slot& s, kind) {
+  if(!s.vectors) s.vectors.reset(new vector_values());
+  return s.vectors->rangeDouble;
+}
+
+template<>
+inline parsed_matrix<int>& typed_cache::field< parsed_matrix<int> >(slot& s, kind) {
+  if(!s.vectors) s.vectors.reset(new vector_values());
+  return s.vectors->matrixInt;
+}
+
+template<>
+inline parsed_matrix<double>& typed_cache::field< parsed_matrix<double> >(slot& s, kind) {
+  if(!s.vectors) s.vectors.reset(new vector_values());
+  return s.vectors->matrixDouble;
+}
+
+#endif
@@ -0,0 +1,224 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef _reloader_hpp_
+#define _reloader_hpp_
+
+#include "config.hpp"
+#include "config_diff.hpp"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Keeps a configuration file loaded while it is being edited.
+ *
+ * Each version of the file is parsed into a new config object, which
+ * is never modified once published. Publishing a version replaces the
+ * current pointer atomically: threads holding the previous version can
+ * keep reading it, and it is destroyed when the last of them releases
+ * it. A version that fails to load (syntax error, invalid key, file
+ * being replaced) is not published, and the previous one remains
+ * current.
+ *
+ * The file can be reloaded explicitly with reload(), or automatically
+ * by a thread that watches the file with inotify (see start()).
+ *
+ * Components can subscribe to the keys under a prefix (see
+ * subscribe()): they are notified of the keys that were added, removed
+ * or changed by each new version, and only if there are any, so that
+ * each component reconfigures only when its own keys change.
+ */
+class config_reloader {
+
+public:
+
+  /**
+   * Called on each new config object before the file is parsed into
+   * it, for instance to define valid keys or load default values.
+   */
+  typedef std::function<void(config&)> setup_function;
+
+  /**
+   * Called when a new version is published, with the changes to the
+   * keys under the subscribed prefix and the new version. It is called
+   * by the thread that reloaded the file, or by the thread that is
+   * already notifying an earlier version, and must not throw.
+   */
+  typedef std::function<void(const config_diff& diff,
+                             const std::shared_ptr<const config>& current)> change_callback;
+
+  /**
+   * Caches the current version of the configuration for one reader
+   * thread. Checking for a new version costs one atomic load, so get()
+   * can be called on every access. A reader must not be shared between
+   * threads.
+   */
+  class reader {
+  public:
+    explicit reader(const config_reloader& reloader);
+
+    /**
+     * Returns the current version of the configuration. The reference
+     * remains valid until the next call to get() on this reader (or
+     * until the reader is destroyed), even if a new version is
+     * published in the meantime.
+     */
+    const config& get() {
+      if(m_reloader->m_generation.load(std::memory_order_acquire) != m_generation)
+        refresh();
+      return *m_config;
+    }
+
+  private:
+    void refresh();
+
+    const config_reloader* m_reloader;
+    uint64_t m_generation;
+    std::shared_ptr<const config> m_config;
+  };
+
+  /**
+   * Loads the configuration file at "filepath".
+   *@param setup  Applied to each new config object (see setup_function).
+   *@throws file_exception        If the file cannot be read.
+   *@throws invalidkey_exception  If a key is deemed invalid.
+   *@throws syntax_exception      If some line has invalid syntax.
+   */
+  explicit config_reloader(std::string filepath, setup_function setup = setup_function());
+
+  /// Stops the watching thread, if any.
+  ~config_reloader();
+
+  /**
+   * Returns the current version of the configuration.
+   */
+  std::shared_ptr<const config> current() const {
+    return std::atomic_load(&m_current);
+  }
+
+  /**
+   * Number of versions published so far (1 after construction).
+   */
+  uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+
+  /**
+   * Parses the file into a new config object and publishes it.
+   *@return 'false' if the file could not be loaded, in which case the
+   *        current version is unchanged (see lastError()).
+   */
+  bool reload();
+
+  /**
+   * Returns the error message of the last reload that failed, or an
+   * empty string if the last reload succeeded. An exception thrown by
+   * a subscriber, or any other exception in the watching thread, is
+   * also reported here.
+   */
+  std::string lastError() const;
+
+  /**
+   * Starts a thread that reloads the file each time it is written or
+   * replaced (e.g. renamed over by an editor). Does nothing if the
+   * thread is already running.
+   *@throws file_exception  If the directory of the file cannot be watched.
+   */
+  void start();
+
+  /**
+   * Stops the watching thread and waits for it to exit.
+   */
+  void stop();
+
+  /**
+   * Calls "callback" each time a new version adds, removes or changes
+   * a key starting with "prefix" (an empty prefix matches every key).
+   * Callbacks are called in the order of subscription, after the new
+   * version is published. Versions are notified one at a time, in the
+   * order they were published, even when reload() is called by several
+   * threads. A callback can call reload(): the version it publishes is
+   * notified once the current notification completes. An exception
+   * thrown by a callback is recorded in lastError() and does not
+   * prevent the next callbacks from being called. The diffs delivered
+   * to a callback chain together: each is relative to the version the
+   * callback received last (or that was current when it subscribed).
+   *@return An identifier for unsubscribe().
+   */
+  uint64_t subscribe(std::string prefix, change_callback callback);
+
+  /**
+   * Removes a subscription. The callback may still be running in
+   * another thread when this returns.
+   */
+  void unsubscribe(uint64_t id);
+
+  std::string getFilePath() const { return m_filePath; }
+
+private:
+
+  config_reloader(const config_reloader&);
+  config_reloader& operator=(const config_reloader&);
+
+  /// Parses the file into a new config object.
+  std::shared_ptr<const config> load() const;
+
+  void setLastError(const std::string& error);
+
+  /// Makes "conf" the current version.
+  void publish(std::shared_ptr<const config> conf);
+
+  /**
+   * Notifies the queued versions, unless another thread is already
+   * doing so.
+   */
+  void notifyPending();
+
+  /// Notifies the subscribers of the changes from "previous" to "current".
+  void notify(const config& previous, const std::shared_ptr<const config>& current);
+
+  /// Body of the watching thread.
+  void watch(int inotifyFd, int stopFd);
+
+  struct subscription {
+    uint64_t id;
+    std::string prefix;
+    change_callback callback;
+  };
+
+  std::string m_filePath;
+  setup_function m_setup;
+
+  /// Current version, accessed with std::atomic_load / atomic_store.
+  std::shared_ptr<const config> m_current;
+  std::atomic<uint64_t> m_generation;
+
+  /// Serializes reload() calls.
+  std::mutex m_reloadMutex;
+  std::string m_lastError;
+  mutable std::mutex m_errorMutex;
+
+  /// Published versions not yet notified, each with the version before it.
+  std::deque<std::pair<std::shared_ptr<const config>,
+                       std::shared_ptr<const config> > > m_pending;
+  /// Whether a thread is delivering the pending notifications.
+  bool m_notifying;
+  /// Protects m_pending and m_notifying (locked after m_reloadMutex).
+  std::mutex m_notifyMutex;
+
+  std::vector<subscription> m_subscriptions;
+  uint64_t m_nextSubscription;
+  std::mutex m_subscriptionMutex;
+
+  std::thread m_watcher;
+  int m_inotifyFd;
+  int m_stopFd;
+};
+
+#endif
@@ -0,0 +1,342 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef _schema_hpp_
+#define _schema_hpp_
+
+#include "config.hpp"
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Strict parsers for the values bound by config_schema: unlike the
+ * getters of config (which behave like atoi() and atof()), a value is
+ * rejected unless it is entirely a valid value of the type.
+ *
+ * Supported types: uint, int, double, bool ("1", "0", "true" or
+ * "false"), std::string, lists "{a, b, ...}" as std::vector of int,
+ * double or std::string, and sequences (see config::getUIntRange())
+ * as seq_range or std::vector of uint or double.
+ */
+class schema_value {
+
+public:
+
+  static bool parse(std::string_view val, uint& out);
+  static bool parse(std::string_view val, int& out);
+  static bool parse(std::string_view val, double& out);
+  static bool parse(std::string_view val, bool& out);
+  static bool parse(std::string_view val, std::string& out);
+  static bool parse(std::string_view val, std::vector<int>& out);
+  static bool parse(std::string_view val, std::vector<double>& out);
+  static bool parse(std::string_view val, std::vector<std::string>& out);
+  static bool parse(std::string_view val, seq_range<uint>& out);
+  static bool parse(std::string_view val, seq_range<double>& out);
+
+  static bool parseSequence(std::string_view val, seq_range<uint>& out);
+  static bool parseSequence(std::string_view val, seq_range<double>& out);
+  static bool parseSequence(std::string_view val, std::vector<uint>& out);
+  static bool parseSequence(std::string_view val, std::vector<double>& out);
+
+  /// Calls "f(key, value)" for each entry of "conf", in insertion order.
+  static void forEach(const config& conf,
+                      const std::function<void(std::string_view, std::string_view)>& f);
+
+  /// Smallest power of 2 that is at least "n" (and at least 1).
+  static constexpr size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while(p < n) p *= 2;
+    return p;
+  }
+
+  /// FNV-1a, with a seed.
+  static constexpr uint32_t hash(std::string_view s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for(size_t i=0; i<s.size(); i++) {
+      h ^= static_cast<unsigned char>(s[i]);
+      h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+  }
+};
+
+/**
+ * Declaration of one key of a schema: its name, the member of the
+ * struct "S" that receives its value, and its default value, written
+ * as in a configuration file (a null default makes the key required).
+ * If "SEQUENCE" is true, the value is parsed as a sequence rather than
+ * a list. Use schema_key() and schema_sequence() to declare keys.
+ */
+template<class S, class T, bool SEQUENCE>
+struct schema_field {
+  typedef T value_type;
+  static constexpr bool is_sequence = SEQUENCE;
+
+  std::string_view name;
+  T S::* member;
+  const char* defaultValue;
+};
+
+/// Declares a key bound to "member" (see schema_field).
+template<class S, class T>
+constexpr schema_field<S, T, false> schema_key(std::string_view name, T S::* member,
+                                               const char* defaultValue = nullptr) {
+  return schema_field<S, T, false>{name, member, defaultValue};
+}
+
+/// Declares a key whose value is a sequence "<start>:<incr>:<end>".
+template<class S, class T>
+constexpr schema_field<S, T, true> schema_sequence(std::string_view name, T S::* member,
+                                                   const char* defaultValue = nullptr) {
+  return schema_field<S, T, true>{name, member, defaultValue};
+}
+
+/**
+ * A compile-time description of the keys of a configuration, bound to
+ * the members of a plain struct "S". Keys, types, defaults and
+ * list/sequence kinds are declared once:
+ *
+ *   struct params { uint nbIter; double snr; std::vector<int> codes; };
+ *
+ *   constexpr auto paramSchema = make_schema<params>(
+ *     schema_key("nb_iter", &params::nbIter, "10"),
+ *     schema_key("snr", &params::snr),
+ *     schema_key("codes", &params::codes, "{1, 2}"));
+ *
+ *   params p = paramSchema.load("run.cfg");
+ *
+ * A file is loaded in a single streaming pass (see config::streamFile())
+ * that parses each value directly into its member. Keys are validated
+ * with a perfect hash table generated at compile time. Unknown keys,
+ * values that are not valid for their type and missing required keys
+ * are all reported when loading, and the values are then plain members
+ * of the struct.
+ */
+template<class S, class... Fields>
+class config_schema {
+
+public:
+
+  static constexpr size_t NB_KEYS = sizeof...(Fields);
+
+  /// Number of slots of the hash table (a power of 2).
+  static constexpr size_t NB_SLOTS = schema_value::roundUpPow2(2 * NB_KEYS);
+
+  /// Number of buckets of the first level of the hash (a power of 2).
+  static constexpr size_t NB_BUCKETS = schema_value::roundUpPow2(NB_KEYS / 2 + 1);
+
+  static constexpr size_t npos = size_t(-1);
+
+  /**
+   * Generates the perfect hash of the keys ("hash and displace": keys
+   * are spread into buckets, and a seed is searched for each bucket so
+   * that its keys land in free slots). When the schema is constexpr,
+   * this happens at compile time, and duplicate keys are a compilation
+   * error.
+   *@throws std::logic_error  If two keys are the same.
+   */
+  constexpr config_schema(Fields... fields)
+    : m_fields(fields...),
+      m_names{{fields.name...}},
+      m_seeds{},
+      m_slots{}
+  {
+    for(size_t i=0; i<NB_KEYS; i++) {
+      for(size_t j=0; j<i; j++) {
+        if(m_names[i] == m_names[j]) throw std::logic_error("config_schema: duplicate keys");
+      }
+    }
+    for(size_t i=0; i<NB_SLOTS; i++) m_slots[i] = EMPTY;
+    std::array<size_t, NB_BUCKETS> bucketSizes{};
+    for(size_t i=0; i<NB_KEYS; i++) bucketSizes[bucketOf(m_names[i])]++;
+    // the largest buckets are placed first, while most slots are free
+    for(size_t size = NB_KEYS; size > 0; size--) {
+      for(size_t b=0; b<NB_BUCKETS; b++) {
+        if(bucketSizes[b] == size) placeBucket(b);
+      }
+    }
+  }
+
+  /**
+   * Returns the index of the declaration of "key", or npos if the key
+   * is not part of the schema.
+   */
+  constexpr size_t find(std::string_view key) const {
+    uint32_t seed = m_seeds[bucketOf(key)];
+    uint8_t slot = m_slots[schema_value::hash(key, seed) & (NB_SLOTS - 1)];
+    if(slot == EMPTY || m_names[slot] != key) return npos;
+    return slot;
+  }
+
+  constexpr std::string_view keyName(size_t i) const { return m_names[i]; }
+
+  /**
+   * Loads the configuration file "filepath" into a new S.
+   *@throws file_exception        If the file cannot be read.
+   *@throws invalidkey_exception  If a key is not part of the schema.
+   *@throws syntax_exception      If a value is not valid for its type, or
+   *                              some line has invalid syntax.
+   *@throws key_not_found         If a required key is missing.
+   */
+  S load(const std::string& filepath) const {
+    S out{};
+    std::bitset<NB_KEYS> seen;
+    config reader;
+    reader.streamFile(filepath, [&](std::string_view key, std::string_view val) {
+        store(key, val, out, seen);
+      });
+    setDefaults(out, seen);
+    return out;
+  }
+
+  /**
+   * Fills a new S from a loaded configuration (for instance, after
+   * config::initCL() and config::initFile()). An empty value (given by
+   * an option "--<key>") sets a bool member to true.
+   *@throws invalidkey_exception  If a key is not part of the schema.
+   *@throws syntax_exception      If a value is not valid for its type.
+   *@throws key_not_found         If a required key is missing.
+   */
+  S bind(const config& conf) const {
+    S out{};
+    std::bitset<NB_KEYS> seen;
+    schema_value::forEach(conf, [&](std::string_view key, std::string_view val) {
+        store(key, val, out, seen);
+      });
+    setDefaults(out, seen);
+    return out;
+  }
+
+  /**
+   * Defines the keys of the schema as the valid keys of "conf" (see
+   * config::addValidKey()).
+   */
+  void addValidKeys(config& conf) const {
+    for(size_t i=0; i<NB_KEYS; i++) conf.addValidKey(m_names[i]);
+  }
+
+private:
+
+  static constexpr uint8_t EMPTY = 0xFF;
+
+  /// Seeds tried for a bucket before giving up.
+  static constexpr uint32_t MAX_SEEDS = 1 << 16;
+
+  static_assert(sizeof...(Fields) < EMPTY, "config_schema: too many keys");
+
+  static constexpr size_t bucketOf(std::string_view key) {
+    return schema_value::hash(key, 0) & (NB_BUCKETS - 1);
+  }
+
+  /// Finds a seed that maps the keys of bucket "b" to free slots.
+  constexpr void placeBucket(size_t b) {
+    for(uint32_t seed = 1; seed < MAX_SEEDS; seed++) {
+      bool placed = true;
+      size_t i = 0;
+      for(; i<NB_KEYS && placed; i++) {
+        if(bucketOf(m_names[i]) != b) continue;
+        size_t slot = schema_value::hash(m_names[i], seed) & (NB_SLOTS - 1);
+        if(m_slots[slot] == EMPTY) m_slots[slot] = static_cast<uint8_t>(i);
+        else placed = false;
+      }
+      if(placed) {
+        m_seeds[b] = seed;
+        return;
+      }
+      // undo the keys placed with this seed
+      for(size_t j=0; j<i; j++) {
+        if(bucketOf(m_names[j]) != b) continue;
+        size_t slot = schema_value::hash(m_names[j], seed) & (NB_SLOTS - 1);
+        if(m_slots[slot] == j) m_slots[slot] = EMPTY;
+      }
+    }
+    throw std::logic_error("config_schema: no perfect hash found");
+  }
+
+  void store(std::string_view key, std::string_view val, S& out,
+             std::bitset<NB_KEYS>& seen) const {
+    size_t i = find(key);
+    if(i == npos) throw invalidkey_exception(std::string(key));
+    setField(i, out, val, std::make_index_sequence<NB_KEYS>());
+    seen.set(i);
+  }
+
+  void setDefaults(S& out, const std::bitset<NB_KEYS>& seen) const {
+    for(size_t i=0; i<NB_KEYS; i++) {
+      if(!seen[i]) setDefault(i, out, std::make_index_sequence<NB_KEYS>());
+    }
+  }
+
+  /// Parses "val" into the member of field "i".
+  template<size_t... I>
+  void setField(size_t i, S& out, std::string_view val, std::index_sequence<I...>) const {
+    typedef void (config_schema::*setter)(S&, std::string_view) const;
+    static constexpr setter setters[] = { &config_schema::set<I>... };
+    (this->*setters[i])(out, val);
+  }
+
+  template<size_t... I>
+  void setDefault(size_t i, S& out, std::index_sequence<I...>) const {
+    typedef void (config_schema::*setter)(S&) const;
+    static constexpr setter setters[] = { &config_schema::setDefaultOf<I>... };
+    (this->*setters[i])(out);
+  }
+
+  template<size_t I>
+  void set(S& out, std::string_view val) const {
+    typedef typename std::tuple_element<I, std::tuple<Fields...>>::type field_type;
+    const field_type& f = std::get<I>(m_fields);
+    bool valid;
+    if constexpr(field_type::is_sequence) {
+      valid = schema_value::parseSequence(val, out.*(f.member));
+    }
+    else if constexpr(std::is_same<typename field_type::value_type, bool>::value) {
+      // an option "--<key>" has an empty value
+      if(val.empty()) valid = out.*(f.member) = true;
+      else valid = schema_value::parse(val, out.*(f.member));
+    }
+    else {
+      valid = schema_value::parse(val, out.*(f.member));
+    }
+    if(!valid) throw syntax_exception(std::string(f.name) + " = " + std::string(val));
+  }
+
+  template<size_t I>
+  void setDefaultOf(S& out) const {
+    const auto& f = std::get<I>(m_fields);
+    if(!f.defaultValue) throw key_not_found(std::string(f.name));
+    set<I>(out, f.defaultValue);
+  }
+
+  // ---------- Data Members ----------
+
+  std::tuple<Fields...> m_fields;
+
+  std::array<std::string_view, NB_KEYS> m_names;
+
+  /// Seed of the hash function of the keys of each bucket.
+  std::array<uint32_t, NB_BUCKETS> m_seeds;
+
+  /// Index of the key hashed to each slot, or EMPTY.
+  std::array<uint8_t, NB_SLOTS> m_slots;
+};
+
+/**
+ * Builds the schema of the struct "S" from declarations made with
+ * schema_key() and schema_sequence().
+ */
+template<class S, class... Fields>
+constexpr config_schema<S, Fields...> make_schema(Fields... fields) {
+  return config_schema<S, Fields...>(fields...);
+}
+
+#endif
@@ -0,0 +1,158 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef _seq_range_hpp_
+#define _seq_range_hpp_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/**
+ * A sequence of numbers described by a start value, a step and a
+ * number of elements, whose elements are computed on access instead of
+ * being stored. The sequence is either linear (element i is start +
+ * i*step) or geometric (element i is start * step^i). Elements are
+ * computed in closed form from their index, so that they do not
+ * accumulate rounding errors.
+ *
+ * A seq_range is a small value type. It can be split into contiguous
+ * sub-ranges (see slice() and shard()), for instance to distribute the
+ * elements of a sweep among workers.
+ */
+template<class T>
+class seq_range {
+
+public:
+
+  /// Type of the step: signed for integer sequences.
+  typedef typename std::conditional<std::is_integral<T>::value, int64_t, T>::type step_type;
+
+  enum progression { LINEAR, GEOMETRIC };
+
+  /**
+   * Random-access iterator over the elements of a range. Dereferencing
+   * computes the element, so the iterator returns values, not
+   * references.
+   */
+  class iterator {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef T reference;
+
+    iterator() : m_range(0), m_index(0) {}
+    iterator(const seq_range* range, size_t index) : m_range(range), m_index(index) {}
+
+    T operator*() const { return (*m_range)[m_index]; }
+    T operator[](difference_type n) const { return (*m_range)[m_index + n]; }
+
+    iterator& operator++() { ++m_index; return *this; }
+    iterator operator++(int) { iterator it = *this; ++m_index; return it; }
+    iterator& operator--() { --m_index; return *this; }
+    iterator operator--(int) { iterator it = *this; --m_index; return it; }
+    iterator& operator+=(difference_type n) { m_index += n; return *this; }
+    iterator& operator-=(difference_type n) { m_index -= n; return *this; }
+    iterator operator+(difference_type n) const { return iterator(m_range, m_index + n); }
+    iterator operator-(difference_type n) const { return iterator(m_range, m_index - n); }
+    difference_type operator-(const iterator& o) const {
+      return difference_type(m_index) - difference_type(o.m_index);
+    }
+
+    bool operator==(const iterator& o) const { return m_index == o.m_index; }
+    bool operator!=(const iterator& o) const { return m_index != o.m_index; }
+    bool operator<(const iterator& o) const { return m_index < o.m_index; }
+    bool operator>(const iterator& o) const { return m_index > o.m_index; }
+    bool operator<=(const iterator& o) const { return m_index <= o.m_index; }
+    bool operator>=(const iterator& o) const { return m_index >= o.m_index; }
+
+  private:
+    const seq_range* m_range;
+    size_t m_index;
+  };
+
+  typedef iterator const_iterator;
+  typedef T value_type;
+
+  /// An empty range.
+  seq_range() : m_start(0), m_step(0), m_offset(0), m_size(0), m_progression(LINEAR) {}
+
+  seq_range(progression p, T start, step_type step, size_t size)
+    : m_start(start), m_step(step), m_offset(0), m_size(size), m_progression(p) {}
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  progression getProgression() const { return m_progression; }
+
+  /// Returns element "i" (0 <= i < size()).
+  T operator[](size_t i) const {
+    size_t n = m_offset + i;
+    if(m_progression == GEOMETRIC)
+      return T(m_start * std::pow(m_step, double(n)));
+    if(std::is_integral<T>::value)
+      return T(step_type(m_start) + m_step * step_type(n));
+    return T(m_start + m_step * T(n));
+  }
+
+  T front() const { return (*this)[0]; }
+  T back() const { return (*this)[m_size - 1]; }
+
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, m_size); }
+
+  /**
+   * Returns the sub-range of "count" elements starting at element
+   * "first". Elements of the sub-range are computed from the same
+   * start value, so they are identical to the elements of this range.
+   *@throws std::invalid_argument  If the sub-range does not lie within
+   *                               this range.
+   */
+  seq_range slice(size_t first, size_t count) const {
+    if(first > m_size || count > m_size - first)
+      throw std::invalid_argument("seq_range::slice: out of range");
+    seq_range r = *this;
+    r.m_offset += first;
+    r.m_size = count;
+    return r;
+  }
+
+  /**
+   * Splits the range into "nbShards" contiguous sub-ranges whose sizes
+   * differ by at most one, and returns sub-range "index".
+   *@throws std::invalid_argument  If "nbShards" is 0 or "index" is not
+   *                               smaller than "nbShards".
+   */
+  seq_range shard(size_t index, size_t nbShards) const {
+    if(nbShards == 0 || index >= nbShards)
+      throw std::invalid_argument("seq_range::shard: invalid shard");
+    size_t base = m_size / nbShards;
+    size_t extra = m_size % nbShards;
+    size_t first = index * base + (index < extra ? index : extra);
+    return slice(first, base + (index < extra ? 1 : 0));
+  }
+
+  /// Returns a vector containing every element.
+  std::vector<T> vector() const {
+    std::vector<T> v;
+    v.reserve(m_size);
+    for(size_t i=0; i<m_size; i++) v.push_back((*this)[i]);
+    return v;
+  }
+
+private:
+  T         m_start;
+  step_type m_step;
+  /// Index (in the sequence starting at m_start) of the first element.
+  size_t    m_offset;
+  size_t    m_size;
+  progression m_progression;
+};
+
+#endif
@@ -0,0 +1,144 @@
+//Author: Francois Leduc-Primeau
+//Copyright 2013
+
+#ifndef _sweep_hpp_
+#define _sweep_hpp_
+
+#include "config.hpp"
+#include "seq_range.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * The cartesian product of a set of keys of a configuration, each of
+ * which describes a list ("{a, b, c}") or a sequence of real numbers
+ * (see config::getDoubleRange()). Each combination of values is a
+ * point of the sweep, identified by an index in [0, size()).
+ *
+ * Points are enumerated as by nested loops over the keys in the order
+ * they are given, the last key varying fastest. A point is computed
+ * from its index without enumerating the others, and the indices can
+ * be split among workers with shard() or stridedShard(), so that each
+ * worker (or each task of a job array) only visits its own points.
+ *
+ * A sweep refers to the values cached by its configuration: the
+ * configuration must outlive the sweep and must not be modified.
+ */
+class sweep {
+
+public:
+
+  /**
+   * One point of a sweep. Getters return the value of the point for
+   * keys of the sweep, and the value of the configuration for other
+   * keys. A point is a small value (a pointer and an index).
+   */
+  class point {
+  public:
+    /// Index of the point in the sweep.
+    size_t index() const { return m_index; }
+
+    /// Index of the value of axis "axis" at this point.
+    size_t coordinate(size_t axis) const {
+      return m_sweep->coordinate(m_index, axis);
+    }
+
+    /**
+     *@throws key_not_found     If the key does not exist.
+     *@throws syntax_exception  (parseParamUInt) If the value of an axis
+     *                          is negative, not an integer or too large.
+     */
+    uint   parseParamUInt(std::string_view key) const;
+    double parseParamDouble(std::string_view key) const;
+    std::string getParamString(std::string_view key) const;
+
+  private:
+    friend class sweep;
+    point(const sweep* s, size_t index) : m_sweep(s), m_index(index) {}
+
+    const sweep* m_sweep;
+    size_t m_index;
+  };
+
+  /**
+   * Builds the sweep over "keys" of "conf".
+   *@throws key_not_found       If a key does not exist.
+   *@throws syntax_exception    If the value of a key is neither a valid
+   *                            list nor a valid sequence.
+   *@throws std::overflow_error If the number of points does not fit in
+   *                            a size_t.
+   */
+  sweep(const config& conf, const std::vector<std::string>& keys);
+
+  /// Number of points (the product of the sizes of the axes).
+  size_t size() const { return m_size; }
+
+  /// Number of keys (axes) of the sweep.
+  size_t nbAxes() const { return m_axes.size(); }
+
+  const std::string& axisName(size_t axis) const { return m_axes[axis].name; }
+
+  /// Number of values of axis "axis".
+  size_t axisSize(size_t axis) const { return m_axes[axis].size; }
+
+  /// Returns point "index" (0 <= index < size()).
+  point at(size_t index) const { return point(this, index); }
+
+  point operator[](size_t index) const { return at(index); }
+
+  /**
+   * Index of the value of axis "axis" at point "index".
+   */
+  size_t coordinate(size_t index, size_t axis) const {
+    return (index / m_axes[axis].stride) % m_axes[axis].size;
+  }
+
+  /**
+   * Splits the points into "nbWorkers" contiguous blocks whose sizes
+   * differ by at most one, and returns the indices of block "worker".
+   *@throws std::invalid_argument  If "nbWorkers" is 0 or "worker" is not
+   *                               smaller than "nbWorkers".
+   */
+  seq_range<size_t> shard(size_t worker, size_t nbWorkers) const;
+
+  /**
+   * Returns the indices worker, worker+nbWorkers, worker+2*nbWorkers,
+   * ... Strided shards balance the load when the cost of a point
+   * depends on the first axes.
+   *@throws std::invalid_argument  As shard().
+   */
+  seq_range<size_t> stridedShard(size_t worker, size_t nbWorkers) const;
+
+private:
+
+  enum axis_kind { LIST_AXIS, RANGE_AXIS };
+
+  struct axis {
+    std::string name;
+    axis_kind kind;
+    size_t size;
+    /// Product of the sizes of the following axes.
+    size_t stride;
+
+    // values of a LIST_AXIS, cached by the configuration
+    const std::vector<std::string>* strings;
+    const std::vector<int>* ints;
+    const std::vector<double>* doubles;
+
+    // values of a RANGE_AXIS
+    seq_range<double> range;
+  };
+
+  /// Checks the arguments of shard() and stridedShard().
+  static void checkWorker(size_t worker, size_t nbWorkers);
+
+  /// Returns the axis named "key", or 0 if "key" is not an axis.
+  const axis* findAxis(std::string_view key) const;
+
+  const config& m_conf;
+  std::vector<axis> m_axes;
+  size_t m_size;
+};
+
+#endif
@@ -0,0 +1,27 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/private/AccessStats.hpp"
+
+namespace {
+  const char* GETTER_NAMES[access_stats::NB_GETTERS] = {
+    "parseParamUInt", "parseParamDouble", "parseParamBool",
+    "getParamString", "getParamView", "checkOption", "keyExists", "resolve",
+    "range", "sequence", "list", "listSize", "array", "matrix"
+  };
+}
+
+const char* access_stats::getterName(getter g) {
+  return GETTER_NAMES[g];
+}
+
+void access_stats::read(arg_table::id_type id, key_access& access) const {
+  const entry& e = m_entries[id];
+  access.totalLookups = 0;
+  for(int g=0; g<NB_GETTERS; g++) {
+    access.lookups[g] = e.lookups[g].load(std::memory_order_relaxed);
+    access.totalLookups += access.lookups[g];
+  }
+  access.parseNs = e.parseNs.load(std::memory_order_relaxed);
+  access.nbParses = e.nbParses.load(std::memory_order_relaxed);
+}
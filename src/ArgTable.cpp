@@ -0,0 +1,174 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/private/ArgTable.hpp"
+
+#include <string.h>
+#include <stdexcept>
+
+// Minimum number of slots in the hash index
+#define MIN_SLOTS 16
+
+// Number of unused arena bytes below which the arena is never compacted
+#define MIN_COMPACTED_BYTES 4096
+
+arg_table::id_type arg_table::find(std::string_view key) const {
+  if(m_slots.empty()) return npos;
+  return find(key, m_slots.data(), m_mask, m_entries.data(), m_arena.data());
+}
+
+arg_table::id_type arg_table::find(std::string_view key, const slot* slots,
+                                   size_t mask, const entry* entries,
+                                   const char* arena) {
+  uint64_t h = hash(key);
+  uint32_t tag = static_cast<uint32_t>(h >> 32);
+  for(size_t i = static_cast<size_t>(h) & mask; ; i = (i+1) & mask) {
+    const slot& s = slots[i];
+    if(s.id == npos) return npos;
+    // only compare the key bytes when the hash tags match
+    if(s.tag == tag) {
+      const entry& e = entries[s.id];
+      if(std::string_view(arena + e.keyOff, e.keyLen) == key) return s.id;
+    }
+  }
+}
+
+arg_table::id_type arg_table::set(std::string_view key, std::string_view val,
+                                  bool overwrite) {
+  // lengths are stored on 32 bits: they must not be truncated
+  if(key.size() > UINT32_MAX || val.size() > UINT32_MAX)
+    throw std::length_error("arg_table: key or value too long");
+
+  // keep the load factor of the index below 1/2
+  if(2*(m_entries.size()+1) > m_slots.size()) {
+    rehash(m_slots.empty() ? MIN_SLOTS : 2*m_slots.size());
+  }
+
+  uint64_t h = hash(key);
+  uint32_t tag = static_cast<uint32_t>(h >> 32);
+  size_t i = static_cast<size_t>(h) & m_mask;
+  for(; m_slots[i].id != npos; i = (i+1) & m_mask) {
+    id_type id = m_slots[i].id;
+    if(m_slots[i].tag == tag && this->key(id) == key) {
+      if(overwrite) replaceValue(id, val);
+      return id;
+    }
+  }
+
+  if(m_entries.size() >= npos) throw std::length_error("arg_table: too many entries");
+  entry e;
+  e.keyOff = append(key);
+  e.keyLen = key.size();
+  e.valOff = append(val);
+  e.valLen = val.size();
+  id_type id = m_entries.size();
+  m_entries.push_back(e);
+  m_slots[i].id = id;
+  m_slots[i].tag = tag;
+  return id;
+}
+
+void arg_table::reserve(size_t nbEntries, size_t nbBytes) {
+  m_arena.reserve(m_arena.size() + nbBytes);
+  m_entries.reserve(m_entries.size() + nbEntries);
+  size_t nbSlots = m_slots.empty() ? MIN_SLOTS : m_slots.size();
+  while(nbSlots < 2*(m_entries.size()+nbEntries)) nbSlots*= 2;
+  if(nbSlots > m_slots.size()) rehash(nbSlots);
+}
+
+void arg_table::assign(const char* arena, size_t arenaSize,
+                       const entry* entries, size_t nbEntries,
+                       const slot* slots, size_t nbSlots) {
+  m_arena.assign(arena, arena + arenaSize);
+  m_entries.assign(entries, entries + nbEntries);
+  m_slots.assign(slots, slots + nbSlots);
+  m_mask = nbSlots - 1;
+  m_unusedBytes = 0;
+}
+
+// Private
+
+uint64_t arg_table::append(std::string_view s) {
+  uint64_t offset = m_arena.size();
+  // "s" may point inside the arena, which can be reallocated by resize()
+  const char* base = m_arena.data();
+  bool inArena = offset > 0 && s.data() >= base && s.data() < base + offset;
+  size_t srcOff = s.data() - base;
+  m_arena.resize(offset + s.size() + 1);
+  const char* src = inArena ? m_arena.data() + srcOff : s.data();
+  if(!s.empty()) memcpy(m_arena.data() + offset, src, s.size());
+  m_arena[offset + s.size()] = '\0';
+  return offset;
+}
+
+void arg_table::replaceValue(id_type id, std::string_view val) {
+  entry& e = m_entries[id];
+  if(val.size() <= e.valLen) {
+    // reuse the bytes of the previous value ("val" may overlap them)
+    if(!val.empty()) memmove(m_arena.data() + e.valOff, val.data(), val.size());
+    m_arena[e.valOff + val.size()] = '\0';
+    m_unusedBytes += e.valLen - val.size();
+    e.valLen = val.size();
+    return;
+  }
+  uint64_t valOff = append(val);
+  m_unusedBytes += e.valLen + 1;
+  e.valOff = valOff;
+  e.valLen = val.size();
+  if(m_unusedBytes > MIN_COMPACTED_BYTES && 2*m_unusedBytes > m_arena.size()) compact();
+}
+
+void arg_table::compact() {
+  // the capacity is kept, since it may have been reserved for a load
+  std::vector<char> arena;
+  arena.reserve(m_arena.capacity());
+  for(id_type id=0; id<m_entries.size(); id++) {
+    entry& e = m_entries[id];
+    uint64_t keyOff = arena.size();
+    arena.insert(arena.end(), m_arena.begin() + e.keyOff, m_arena.begin() + e.keyOff + e.keyLen + 1);
+    uint64_t valOff = arena.size();
+    arena.insert(arena.end(), m_arena.begin() + e.valOff, m_arena.begin() + e.valOff + e.valLen + 1);
+    e.keyOff = keyOff;
+    e.valOff = valOff;
+  }
+  m_arena.swap(arena);
+  m_unusedBytes = 0;
+}
+
+void arg_table::rehash(size_t nbSlots) {
+  slot empty;
+  empty.id = npos;
+  empty.tag = 0;
+  m_slots.assign(nbSlots, empty);
+  m_mask = nbSlots - 1;
+  for(id_type id=0; id<m_entries.size(); id++) {
+    uint64_t h = hash(key(id));
+    size_t i = static_cast<size_t>(h) & m_mask;
+    while(m_slots[i].id != npos) i = (i+1) & m_mask;
+    m_slots[i].id = id;
+    m_slots[i].tag = static_cast<uint32_t>(h >> 32);
+  }
+}
+
+uint64_t arg_table::hash(std::string_view s) {
+  // Hashes 8 bytes at a time, using multiply-xorshift mixing steps.
+  const uint64_t mult = 0x9E3779B97F4A7C15ULL;
+  const char* p = s.data();
+  size_t n = s.size();
+  uint64_t h = n * mult;
+  uint64_t w;
+  for(; n >= 8; p += 8, n -= 8) {
+    memcpy(&w, p, 8);
+    h = (h ^ w) * mult;
+    h ^= h >> 29;
+  }
+  if(n > 0) {
+    w = 0;
+    memcpy(&w, p, n);
+    h = (h ^ w) * mult;
+    h ^= h >> 29;
+  }
+  h *= 0xBF58476D1CE4E5B9ULL;
+  h ^= h >> 32;
+  return h;
+}
@@ -0,0 +1,131 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/private/ArrayFile.hpp"
+#include "config/private/CustomExceptions.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <boost/filesystem.hpp>
+
+using std::string;
+using boost::filesystem::path;
+
+const std::string_view array_file::PREFIX = "@file:";
+
+namespace {
+  struct type_info {
+    const char* extension;
+    array_file::elem_type type;
+    size_t size;
+  };
+
+  const type_info TYPES[] = {
+    { ".f64", array_file::F64, sizeof(double) },
+    { ".f32", array_file::F32, sizeof(float) },
+    { ".i64", array_file::I64, sizeof(int64_t) },
+    { ".i32", array_file::I32, sizeof(int32_t) },
+  };
+
+  const size_t NB_TYPES = sizeof(TYPES) / sizeof(TYPES[0]);
+}
+
+string array_file::resolvePath(std::string_view val, const string& configPath) {
+  path p(string(val.substr(PREFIX.size())));
+  if(p.is_absolute() || configPath.empty()) return p.string();
+  return (path(configPath).parent_path() / p).string();
+}
+
+array_file::elem_type array_file::typeOf(std::string_view filePath) {
+  for(size_t i=0; i<NB_TYPES; i++) {
+    std::string_view ext = TYPES[i].extension;
+    if(filePath.size() >= ext.size() &&
+       filePath.compare(filePath.size() - ext.size(), ext.size(), ext) == 0)
+      return TYPES[i].type;
+  }
+  return INVALID;
+}
+
+size_t array_file::elemSize(elem_type t) {
+  for(size_t i=0; i<NB_TYPES; i++) {
+    if(TYPES[i].type == t) return TYPES[i].size;
+  }
+  return 0;
+}
+
+array_file::array_file(const string& filePath)
+  : m_type(typeOf(filePath)),
+    m_size(0)
+{
+  if(m_type == INVALID) throw syntax_exception(PREFIX.data() + filePath);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+  // the elements are used in place: they must be in the host's byte order
+  throw file_exception(filePath);
+#endif
+  if(!m_file.map(filePath) || m_file.size() % elemSize(m_type) != 0)
+    throw file_exception(filePath);
+  m_size = m_file.size() / elemSize(m_type);
+}
+
+void array_file::copyTo(int* out, size_t n) const {
+  convert(out, n);
+}
+
+void array_file::copyTo(double* out, size_t n) const {
+  convert(out, n);
+}
+
+void array_file::copyTo(std::vector<string>& out) const {
+  out.clear();
+  out.reserve(m_size);
+  char buffer[32];
+  for(size_t i=0; i<m_size; i++) {
+    std::to_chars_result r;
+    switch(m_type) {
+    case F64: r = std::to_chars(buffer, buffer + sizeof(buffer), data<double>()[i]); break;
+    case F32: r = std::to_chars(buffer, buffer + sizeof(buffer), data<float>()[i]); break;
+    case I64: r = std::to_chars(buffer, buffer + sizeof(buffer), data<int64_t>()[i]); break;
+    default:  r = std::to_chars(buffer, buffer + sizeof(buffer), data<int32_t>()[i]); break;
+    }
+    out.push_back(string(buffer, r.ptr));
+  }
+}
+
+namespace {
+  /**
+   * Converts "v" to T. Integers saturate at the limits of T, like
+   * list_scanner::toInt(), and NaN converts to 0: converting a value
+   * out of range would otherwise be undefined.
+   */
+  template<class T, class S>
+  inline T saturate(S v) {
+    if constexpr(std::is_floating_point<T>::value) {
+      return T(v);
+    } else if constexpr(std::is_floating_point<S>::value) {
+      if(std::isnan(v)) return 0;
+      // the limits of T are exact in long double
+      if((long double)v <= (long double)std::numeric_limits<T>::min())
+        return std::numeric_limits<T>::min();
+      if((long double)v >= (long double)std::numeric_limits<T>::max())
+        return std::numeric_limits<T>::max();
+      return T(v);
+    } else {
+      if(v < (S)std::numeric_limits<T>::min()) return std::numeric_limits<T>::min();
+      if(v > (S)std::numeric_limits<T>::max()) return std::numeric_limits<T>::max();
+      return T(v);
+    }
+  }
+}
+
+template<class T>
+void array_file::convert(T* out, size_t n) const {
+  if(n > m_size) n = m_size;
+  switch(m_type) {
+  case F64: for(size_t i=0; i<n; i++) out[i] = saturate<T>(data<double>()[i]); break;
+  case F32: for(size_t i=0; i<n; i++) out[i] = saturate<T>(data<float>()[i]); break;
+  case I64: for(size_t i=0; i<n; i++) out[i] = saturate<T>(data<int64_t>()[i]); break;
+  default:  for(size_t i=0; i<n; i++) out[i] = saturate<T>(data<int32_t>()[i]); break;
+  }
+}
@@ -0,0 +1,326 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/private/ConfigImage.hpp"
+#include "config/private/FileMapping.hpp"
+
+#include <string.h>
+#include <sys/stat.h>
+
+using std::string;
+using std::vector;
+
+namespace {
+  const char IMAGE_MAGIC[8] = {'C','F','G','I','M','G','\0','\0'};
+  const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+  inline uint64_t align8(uint64_t off) { return (off + 7) & ~uint64_t(7); }
+
+  /// Checks that [off, off+count*elemSize) lies within [0, limit).
+  inline bool fits(uint64_t off, uint64_t count, uint64_t elemSize, uint64_t limit) {
+    if(off > limit) return false;
+    if(elemSize != 0 && count > (limit - off) / elemSize) return false;
+    return true;
+  }
+
+  inline size_t listIndex(typed_cache::kind k) { return k - typed_cache::LIST_INT; }
+
+  /// Element size of the numeric lists, indexed by listIndex().
+  const uint64_t LIST_ELEM_SIZE[CONFIG_IMAGE_NBLISTS] = { sizeof(int), sizeof(double), 0 };
+}
+
+bool image_source::stat(const string& path, image_source& info, bool withHash) {
+  struct ::stat st;
+  if(::stat(path.c_str(), &st) != 0) return false;
+  info.path = path;
+  info.mtimeSec = st.st_mtim.tv_sec;
+  info.mtimeNsec = st.st_mtim.tv_nsec;
+  info.size = st.st_size;
+  info.hash = 0;
+  if(!withHash) return true;
+
+  file_mapping file;
+  if(!file.map(path)) return false;
+  info.hash = arg_table::hash(std::string_view(file.data(), file.size()));
+  return true;
+}
+
+// ---------- image_builder ----------
+
+image_builder::image_builder(const arg_table& table)
+  : m_table(table),
+    m_records(table.size())
+{}
+
+void image_builder::setScalars(arg_table::id_type id, uint uintVal,
+                               double doubleVal, bool boolVal) {
+  typed_record& r = m_records[id];
+  r.uintVal = uintVal;
+  r.doubleVal = doubleVal;
+  r.boolVal = boolVal;
+  r.present |= (1u << typed_cache::UINT) | (1u << typed_cache::DOUBLE) |
+    (1u << typed_cache::BOOL);
+}
+
+void image_builder::setList(arg_table::id_type id, typed_cache::kind k,
+                            const parsed_list<int>& list) {
+  setNumericList(id, k, list);
+}
+
+void image_builder::setList(arg_table::id_type id, typed_cache::kind k,
+                            const parsed_list<double>& list) {
+  setNumericList(id, k, list);
+}
+
+void image_builder::setList(arg_table::id_type id, typed_cache::kind k,
+                            const parsed_list<string>& list) {
+  typed_record& r = m_records[id];
+  r.present |= 1u << k;
+  if(list.valid) r.valid |= 1u << k;
+  r.listLen[listIndex(k)] = list.values.size();
+  r.listOff[listIndex(k)] = m_payload.size();
+  for(size_t i=0; i<list.values.size(); i++) {
+    uint32_t len = list.values[i].size();
+    const char* p = reinterpret_cast<const char*>(&len);
+    m_payload.insert(m_payload.end(), p, p + sizeof(len));
+    m_payload.insert(m_payload.end(), list.values[i].begin(), list.values[i].end());
+  }
+  m_payload.resize(align8(m_payload.size()), '\0');
+}
+
+void image_builder::setRange(arg_table::id_type id, const parsed_range<uint>& range) {
+  typed_record& r = m_records[id];
+  r.present |= 1u << typed_cache::RANGE_UINT;
+  if(range.valid) r.valid |= 1u << typed_cache::RANGE_UINT;
+  r.uintRange = range.range;
+}
+
+void image_builder::setRange(arg_table::id_type id, const parsed_range<double>& range) {
+  typed_record& r = m_records[id];
+  r.present |= 1u << typed_cache::RANGE_DOUBLE;
+  if(range.valid) r.valid |= 1u << typed_cache::RANGE_DOUBLE;
+  r.doubleRange = range.range;
+}
+
+template<class T>
+void image_builder::setNumericList(arg_table::id_type id, typed_cache::kind k,
+                                   const parsed_list<T>& list) {
+  typed_record& r = m_records[id];
+  r.present |= 1u << k;
+  if(list.valid) r.valid |= 1u << k;
+  r.listLen[listIndex(k)] = list.values.size();
+  r.listOff[listIndex(k)] = appendPayload(list.values.data(), list.values.size() * sizeof(T));
+}
+
+uint64_t image_builder::appendPayload(const void* data, size_t n) {
+  uint64_t offset = m_payload.size();
+  const char* p = static_cast<const char*>(data);
+  m_payload.insert(m_payload.end(), p, p + n);
+  m_payload.resize(align8(m_payload.size()), '\0');
+  return offset;
+}
+
+vector<char> image_builder::finish() const {
+  image_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+  h.version = CONFIG_IMAGE_VERSION;
+  h.byteOrder = BYTE_ORDER_MARK;
+  h.nbEntries = m_table.m_entries.size();
+  h.nbSlots = m_table.m_slots.size();
+
+  uint64_t off = align8(sizeof(image_header));
+  h.slotsOff = off;
+  off = align8(off + h.nbSlots * sizeof(arg_table::slot));
+  h.entriesOff = off;
+  off = align8(off + h.nbEntries * sizeof(arg_table::entry));
+  h.arenaOff = off;
+  h.arenaSize = m_table.m_arena.size();
+  off = align8(off + h.arenaSize);
+  h.recordsOff = off;
+  off = align8(off + h.nbEntries * sizeof(typed_record));
+  h.payloadOff = off;
+  h.sourcePathOff = m_payload.size();
+  h.sourcePathLen = m_sourcePath.size();
+  // the stamps, then their paths, follow the source path
+  vector<image_stamp> stamps(m_stamps.size());
+  h.stampsOff = align8(h.sourcePathOff + h.sourcePathLen);
+  h.nbStamps = stamps.size();
+  uint64_t pathOff = h.stampsOff + stamps.size() * sizeof(image_stamp);
+  for(size_t i=0; i<stamps.size(); i++) {
+    stamps[i].pathOff = pathOff;
+    stamps[i].pathLen = m_stamps[i].path.size();
+    stamps[i].mtimeSec = m_stamps[i].mtimeSec;
+    stamps[i].mtimeNsec = m_stamps[i].mtimeNsec;
+    stamps[i].size = m_stamps[i].size;
+    stamps[i].hash = m_stamps[i].hash;
+    pathOff += stamps[i].pathLen;
+  }
+  h.payloadSize = align8(pathOff);
+  h.totalSize = off + h.payloadSize;
+
+  vector<char> image(h.totalSize, '\0');
+  char* p = image.data();
+  memcpy(p, &h, sizeof(h));
+  if(h.nbSlots > 0)
+    memcpy(p + h.slotsOff, m_table.m_slots.data(), h.nbSlots * sizeof(arg_table::slot));
+  if(h.nbEntries > 0) {
+    memcpy(p + h.entriesOff, m_table.m_entries.data(), h.nbEntries * sizeof(arg_table::entry));
+    memcpy(p + h.recordsOff, m_records.data(), h.nbEntries * sizeof(typed_record));
+  }
+  if(h.arenaSize > 0) memcpy(p + h.arenaOff, m_table.m_arena.data(), h.arenaSize);
+  if(!m_payload.empty()) memcpy(p + h.payloadOff, m_payload.data(), m_payload.size());
+  if(!m_sourcePath.empty())
+    memcpy(p + h.payloadOff + h.sourcePathOff, m_sourcePath.data(), m_sourcePath.size());
+  if(!stamps.empty())
+    memcpy(p + h.payloadOff + h.stampsOff, stamps.data(), stamps.size() * sizeof(image_stamp));
+  for(size_t i=0; i<stamps.size(); i++) {
+    memcpy(p + h.payloadOff + stamps[i].pathOff, m_stamps[i].path.data(), stamps[i].pathLen);
+  }
+  return image;
+}
+
+// ---------- image_view ----------
+
+bool image_view::attach(const char* data, size_t size) {
+  m_data = 0;
+  m_header = 0;
+  if(size < sizeof(image_header) || reinterpret_cast<uintptr_t>(data) % 8 != 0)
+    return false;
+  const image_header* h = reinterpret_cast<const image_header*>(data);
+  if(memcmp(h->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0 ||
+     h->version != CONFIG_IMAGE_VERSION || h->byteOrder != BYTE_ORDER_MARK ||
+     h->totalSize > size)
+    return false;
+
+  // sections
+  uint64_t total = h->totalSize;
+  if(h->slotsOff % 8 || h->entriesOff % 8 || h->arenaOff % 8 ||
+     h->recordsOff % 8 || h->payloadOff % 8)
+    return false;
+  if(!fits(h->slotsOff, h->nbSlots, sizeof(arg_table::slot), total) ||
+     !fits(h->entriesOff, h->nbEntries, sizeof(arg_table::entry), total) ||
+     !fits(h->arenaOff, h->arenaSize, 1, total) ||
+     !fits(h->recordsOff, h->nbEntries, sizeof(typed_record), total) ||
+     !fits(h->payloadOff, h->payloadSize, 1, total) ||
+     !fits(h->sourcePathOff, h->sourcePathLen, 1, h->payloadSize) ||
+     h->stampsOff % 8 ||
+     !fits(h->stampsOff, h->nbStamps, sizeof(image_stamp), h->payloadSize))
+    return false;
+  if(h->nbEntries >= arg_table::npos) return false;
+  // the index needs a free slot, and its size must be a power of 2
+  if(h->nbSlots == 0 ? h->nbEntries != 0 :
+     (h->nbSlots & (h->nbSlots - 1)) != 0 || h->nbSlots <= h->nbEntries)
+    return false;
+
+  // every reference must stay within its section
+  const arg_table::slot* slots = reinterpret_cast<const arg_table::slot*>(data + h->slotsOff);
+  for(uint64_t i=0; i<h->nbSlots; i++) {
+    if(slots[i].id != arg_table::npos && slots[i].id >= h->nbEntries) return false;
+  }
+  const arg_table::entry* entries = reinterpret_cast<const arg_table::entry*>(data + h->entriesOff);
+  const char* arena = data + h->arenaOff;
+  const typed_record* records = reinterpret_cast<const typed_record*>(data + h->recordsOff);
+  const char* payload = data + h->payloadOff;
+  const image_stamp* stamps = reinterpret_cast<const image_stamp*>(payload + h->stampsOff);
+  for(uint64_t i=0; i<h->nbStamps; i++) {
+    if(!fits(stamps[i].pathOff, stamps[i].pathLen, 1, h->payloadSize)) return false;
+  }
+  for(uint64_t id=0; id<h->nbEntries; id++) {
+    const arg_table::entry& e = entries[id];
+    // keys and values are followed by a null character
+    if(!fits(e.keyOff, uint64_t(e.keyLen) + 1, 1, h->arenaSize) ||
+       !fits(e.valOff, uint64_t(e.valLen) + 1, 1, h->arenaSize) ||
+       arena[e.keyOff + e.keyLen] != '\0' || arena[e.valOff + e.valLen] != '\0')
+      return false;
+
+    const typed_record& r = records[id];
+    if(r.source != typed_record::NO_SOURCE && r.source >= h->nbStamps) return false;
+    for(size_t l=0; l<CONFIG_IMAGE_NBLISTS; l++) {
+      if(!(r.present & (1u << (typed_cache::LIST_INT + l)))) continue;
+      if(LIST_ELEM_SIZE[l] > 0) {
+        if(r.listOff[l] % 8 ||
+           !fits(r.listOff[l], r.listLen[l], LIST_ELEM_SIZE[l], h->payloadSize))
+          return false;
+      } else {
+        // string list: walk the (length, bytes) items
+        uint64_t off = r.listOff[l];
+        for(uint64_t i=0; i<r.listLen[l]; i++) {
+          uint32_t len;
+          if(!fits(off, sizeof(len), 1, h->payloadSize)) return false;
+          memcpy(&len, payload + off, sizeof(len));
+          off += sizeof(len);
+          if(!fits(off, len, 1, h->payloadSize)) return false;
+          off += len;
+        }
+      }
+    }
+  }
+
+  m_data = data;
+  m_header = h;
+  return true;
+}
+
+bool image_view::isFresh() const {
+  for(size_t i=0; i<nbStamps(); i++) {
+    const image_stamp& saved = stamp(i);
+    string path(stampPath(i));
+    image_source source;
+    if(!image_source::stat(path, source, false) || source.size != saved.size)
+      return false;
+    if(source.mtimeSec != saved.mtimeSec || source.mtimeNsec != saved.mtimeNsec) {
+      // the file was touched: compare its content
+      if(!image_source::stat(path, source, true) || source.hash != saved.hash)
+        return false;
+    }
+  }
+  return true;
+}
+
+void image_view::getList(arg_table::id_type id, typed_cache::kind k,
+                         parsed_list<int>& list) const {
+  getNumericList(id, k, list);
+}
+
+void image_view::getList(arg_table::id_type id, typed_cache::kind k,
+                         parsed_list<double>& list) const {
+  getNumericList(id, k, list);
+}
+
+void image_view::getList(arg_table::id_type id, typed_cache::kind k,
+                         parsed_list<string>& list) const {
+  const typed_record& r = record(id);
+  list.valid = (r.valid & (1u << k)) != 0;
+  list.values.clear();
+  list.values.reserve(r.listLen[listIndex(k)]);
+  const char* p = payload() + r.listOff[listIndex(k)];
+  for(uint64_t i=0; i<r.listLen[listIndex(k)]; i++) {
+    uint32_t len;
+    memcpy(&len, p, sizeof(len));
+    p += sizeof(len);
+    list.values.push_back(string(p, len));
+    p += len;
+  }
+}
+
+void image_view::getRange(arg_table::id_type id, parsed_range<uint>& range) const {
+  const typed_record& r = record(id);
+  range.valid = (r.valid & (1u << typed_cache::RANGE_UINT)) != 0;
+  range.range = r.uintRange;
+}
+
+void image_view::getRange(arg_table::id_type id, parsed_range<double>& range) const {
+  const typed_record& r = record(id);
+  range.valid = (r.valid & (1u << typed_cache::RANGE_DOUBLE)) != 0;
+  range.range = r.doubleRange;
+}
+
+template<class T>
+void image_view::getNumericList(arg_table::id_type id, typed_cache::kind k,
+                                parsed_list<T>& list) const {
+  size_t n;
+  const T* elems = array<T>(id, k, n);
+  list.valid = (record(id).valid & (1u << k)) != 0;
+  list.values.assign(elems, elems + n);
+}
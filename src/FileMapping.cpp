@@ -0,0 +1,50 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/private/FileMapping.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool file_mapping::map(const std::string& path) {
+  unmap();
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0) return false;
+  return mapFd(fd);
+}
+
+bool file_mapping::mapShared(const std::string& name) {
+  unmap();
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if(fd < 0) return false;
+  return mapFd(fd);
+}
+
+void file_mapping::unmap() {
+  if(m_data) munmap(const_cast<char*>(m_data), m_size);
+  m_data = 0;
+  m_size = 0;
+}
+
+// Private
+
+bool file_mapping::mapFd(int fd) {
+  struct stat st;
+  if(fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  if(size == 0) {
+    close(fd);
+    return true;
+  }
+  void* mapping = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED) return false;
+  m_data = static_cast<const char*>(mapping);
+  m_size = size;
+  return true;
+}
@@ -0,0 +1,94 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/private/LineScanner.hpp"
+
+#include <string.h>
+
+namespace {
+  // characters that the regex '.' does not match
+  inline bool isLineTerminator(char c) { return c=='\n' || c=='\r'; }
+}
+
+bool line_scanner::scanKeyVal(const char* begin, const char* end,
+                              range& key, range& val) {
+  const char* keyBegin = 0; // start of the current run of key characters
+  const char* keyEnd = 0;   // end of that run, once whitespace follows it
+
+  for(const char* p=begin; p<end; p++) {
+    char c = *p;
+    if(isKeyChar(c)) {
+      if(!keyBegin || keyEnd) {
+        keyBegin = p;
+        keyEnd = 0;
+      }
+    }
+    else if(isSpace(c)) {
+      if(keyBegin && !keyEnd) keyEnd = p;
+    }
+    else if(c == '=' && keyBegin) {
+      if(!keyEnd) keyEnd = p;
+      // skip the whitespace following '='
+      const char* q = p+1;
+      while(q<end && isSpace(*q)) q++;
+      if(q == end) {
+        // The value must contain at least one character: give back
+        // the last whitespace character that is not a line terminator.
+        while(q > p+1 && isLineTerminator(*(q-1))) q--;
+        if(q == p+1) return false; // nothing left after '=' on this line
+        q--;
+      }
+      const char* valEnd = q;
+      while(valEnd<end && !isLineTerminator(*valEnd)) valEnd++;
+      key.begin = keyBegin;
+      key.end = keyEnd;
+      val.begin = q;
+      val.end = valEnd;
+      return true;
+    }
+    else {
+      keyBegin = 0;
+      keyEnd = 0;
+    }
+  }
+  return false;
+}
+
+bool line_scanner::scanOption(const char* begin, const char* end,
+                              range& option) {
+  // the option must extend to the end of the input, excluding whitespace
+  const char* optEnd = end;
+  while(optEnd>begin && isSpace(*(optEnd-1))) optEnd--;
+  const char* runBegin = optEnd;
+  while(runBegin>begin && isOptionChar(*(runBegin-1))) runBegin--;
+
+  // leftmost "--" in the run that is followed by at least one character
+  for(const char* p=runBegin; p+2<optEnd; p++) {
+    if(p[0]=='-' && p[1]=='-') {
+      option.begin = p+2;
+      option.end = optEnd;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool line_scanner::scanInclude(const char* begin, const char* end, range& path) {
+  static const char KEYWORD[] = "include";
+  const size_t keywordLen = sizeof(KEYWORD) - 1;
+  if(size_t(end - begin) <= keywordLen || memcmp(begin, KEYWORD, keywordLen) != 0 ||
+     !isSpace(begin[keywordLen])) return false;
+  path.begin = begin + keywordLen;
+  path.end = end;
+  trim(path.begin, path.end);
+  if(path.size() >= 2 && *path.begin == '"' && *(path.end-1) == '"') {
+    path.begin++;
+    path.end--;
+  }
+  return path.size() > 0;
+}
+
+void line_scanner::trim(const char*& begin, const char*& end) {
+  while(begin<end && isSpace(*begin)) begin++;
+  while(end>begin && isSpace(*(end-1))) end--;
+}
@@ -0,0 +1,247 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/private/ListScanner.hpp"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <charconv>
+#include <string>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+  // characters that the regex '.' does not match
+  inline bool isLineTerminator(char c) { return c=='\n' || c=='\r'; }
+
+  /// Number of ',' in [begin, end).
+  size_t countCommas(const char* p, const char* end) {
+    size_t n = 0;
+#ifdef __SSE2__
+    const __m128i commas = _mm_set1_epi8(',');
+    for(; end - p >= 16; p += 16) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      n += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(block, commas)));
+    }
+#endif
+    for(; p < end; p++) n += (*p == ',');
+    return n;
+  }
+
+  /**
+   * Parses the elements of a list with "convert" into "out".
+   */
+  template<class T, class Convert>
+  size_t parseInto(const char* begin, const char* end, T* out, size_t capacity,
+                   Convert convert) {
+    size_t n = 0;
+    list_scanner::forEach(begin, end, [&](const char* elemBegin, const char* elemEnd) {
+        if(n < capacity) out[n] = convert(elemBegin, elemEnd);
+        n++;
+      });
+    return n;
+  }
+}
+
+namespace {
+  /**
+   * Recursive-descent parser of a nested list, which appends the
+   * numbers directly to the output and checks the shape as it goes.
+   */
+  template<class T>
+  class nested_parser {
+  public:
+    nested_parser(const char* begin, const char* end,
+                  std::vector<T>& values, std::vector<size_t>& shape)
+      : m_p(begin), m_end(end), m_values(values), m_shape(shape), m_rank(0) {}
+
+    bool parse() {
+      m_values.clear();
+      m_shape.clear();
+      m_p = list_scanner::skipSpace(m_p, m_end);
+      if(m_p == m_end || *m_p != '{' || !parseList(0)) return false;
+      return list_scanner::skipSpace(m_p, m_end) == m_end;
+    }
+
+  private:
+    static constexpr size_t UNKNOWN_SIZE = SIZE_MAX;
+
+    /// Parses the list at m_p (a '{'), at nesting level "depth".
+    bool parseList(size_t depth) {
+      // bounds the recursion on hostile input
+      if(depth >= list_scanner::MAX_NESTING) return false;
+      m_p++;
+      m_p = list_scanner::skipSpace(m_p, m_end);
+      bool sublists = (m_p < m_end && *m_p == '{');
+      size_t n = 0;
+      if(m_p < m_end && *m_p == '}') {
+        m_p++;
+      } else {
+        for(;;) {
+          m_p = list_scanner::skipSpace(m_p, m_end);
+          if(m_p == m_end) return false;
+          if(sublists) {
+            if(*m_p != '{' || !parseList(depth + 1)) return false;
+          } else if(!parseNumber()) {
+            return false;
+          }
+          n++;
+          m_p = list_scanner::skipSpace(m_p, m_end);
+          if(m_p == m_end) return false;
+          if(*m_p == '}') {
+            m_p++;
+            break;
+          }
+          if(*m_p != ',') return false;
+          m_p++;
+        }
+      }
+
+      // lists of numbers (and empty lists) are the innermost level
+      if(!sublists) {
+        if(m_rank == 0) m_rank = depth + 1;
+        else if(m_rank != depth + 1) return false;
+      }
+      // inner lists are closed first: the outer sizes are not known yet
+      if(m_shape.size() <= depth) m_shape.resize(depth + 1, UNKNOWN_SIZE);
+      if(m_shape[depth] == UNKNOWN_SIZE) m_shape[depth] = n;
+      return m_shape[depth] == n;
+    }
+
+    /// Parses a number ending at the next ',' or '}'.
+    bool parseNumber() {
+      const char* begin = m_p;
+      while(m_p < m_end && *m_p != ',' && *m_p != '}' && *m_p != '{') m_p++;
+      const char* end = m_p;
+      while(end > begin && line_scanner::isSpace(*(end-1))) end--;
+      // same rules as the conversions of schema_value: one optional sign
+      if(begin < end && *begin == '+') {
+        begin++;
+        if(begin < end && *begin == '-') return false;
+      }
+      if(begin == end) return false;
+      T value;
+      std::from_chars_result r = std::from_chars(begin, end, value);
+      if(r.ec != std::errc() || r.ptr != end) return false;
+      m_values.push_back(value);
+      return true;
+    }
+
+    const char* m_p;
+    const char* m_end;
+    std::vector<T>& m_values;
+    std::vector<size_t>& m_shape;
+    /// Depth of the innermost lists, once known.
+    size_t m_rank;
+  };
+
+  template<class T>
+  bool parseNestedList(const char* begin, const char* end,
+                       std::vector<T>& values, std::vector<size_t>& shape) {
+    nested_parser<T> parser(begin, end, values, shape);
+    if(parser.parse()) return true;
+    values.clear();
+    shape.clear();
+    return false;
+  }
+}
+
+bool list_scanner::parseNested(const char* begin, const char* end,
+                               std::vector<int>& values, std::vector<size_t>& shape) {
+  return parseNestedList(begin, end, values, shape);
+}
+
+bool list_scanner::parseNested(const char* begin, const char* end,
+                               std::vector<double>& values, std::vector<size_t>& shape) {
+  return parseNestedList(begin, end, values, shape);
+}
+
+bool list_scanner::findContent(const char* begin, const char* end,
+                               line_scanner::range& content) {
+  // leftmost '{' that is followed, on the same line, by at least one
+  // character and a '}'; the content extends to the last such '}'
+  for(const char* open = begin; open < end; open++) {
+    open = static_cast<const char*>(memchr(open, '{', end - open));
+    if(!open) return false;
+    const char* lineEnd = open + 1;
+    while(lineEnd < end && !isLineTerminator(*lineEnd)) lineEnd++;
+    for(const char* close = lineEnd - 1; close >= open + 2; close--) {
+      if(*close == '}') {
+        content.begin = open + 1;
+        content.end = close;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+size_t list_scanner::count(const char* begin, const char* end) {
+  // one element per comma, plus the last one unless it is blank
+  const char* p = end;
+  while(p > begin && line_scanner::isSpace(*(p-1))) p--;
+  size_t n = countCommas(begin, end);
+  if(p > begin && *(p-1) != ',') n++;
+  return n;
+}
+
+const char* list_scanner::findComma(const char* p, const char* end) {
+#ifdef __SSE2__
+  const __m128i commas = _mm_set1_epi8(',');
+  for(; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, commas));
+    if(mask) return p + __builtin_ctz(mask);
+  }
+#endif
+  for(; p < end; p++) {
+    if(*p == ',') return p;
+  }
+  return end;
+}
+
+size_t list_scanner::parse(const char* begin, const char* end, int* out, size_t capacity) {
+  return parseInto(begin, end, out, capacity, toInt);
+}
+
+size_t list_scanner::parse(const char* begin, const char* end, double* out, size_t capacity) {
+  return parseInto(begin, end, out, capacity, toDouble);
+}
+
+int list_scanner::toInt(const char* begin, const char* end) {
+  // atoi() is strtol() converted to int
+  const char* p = skipSpace(begin, end);
+  bool negative = false;
+  if(p < end && (*p == '+' || *p == '-')) negative = (*p++ == '-');
+  if(p == end || *p < '0' || *p > '9') return 0;
+  unsigned long magnitude = 0;
+  std::from_chars_result r = std::from_chars(p, end, magnitude);
+  long value;
+  if(r.ec == std::errc::result_out_of_range) value = negative ? LONG_MIN : LONG_MAX;
+  else if(negative) value = magnitude > (unsigned long)LONG_MAX + 1 ? LONG_MIN : -(long)magnitude;
+  else value = magnitude > (unsigned long)LONG_MAX ? LONG_MAX : (long)magnitude;
+  return (int)value;
+}
+
+double list_scanner::toDouble(const char* begin, const char* end) {
+  const char* p = skipSpace(begin, end);
+  bool negative = false;
+  if(p < end && (*p == '+' || *p == '-')) negative = (*p++ == '-');
+  // from_chars() does not accept a second sign, and does not parse
+  // hexadecimal numbers the way strtod() does
+  bool hex = end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X');
+  if(p < end && *p != '+' && *p != '-' && !hex) {
+    double value;
+    std::from_chars_result r = std::from_chars(p, end, value);
+    if(r.ec == std::errc()) return negative ? -value : value;
+    if(r.ec == std::errc::invalid_argument) return 0;
+  }
+  else if(!hex) return 0;
+  // rare cases (overflow, hexadecimal): use atof() on a copy
+  std::string elem(begin, end);
+  return atof(elem.c_str());
+}
@@ -0,0 +1,135 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/private/ParsedFile.hpp"
+#include "config/private/CustomExceptions.hpp"
+#include "config/private/FileMapping.hpp"
+#include "config/private/LineScanner.hpp"
+
+#include <string.h>
+#include <sys/stat.h>
+#include <mutex>
+#include <unordered_map>
+
+using std::string;
+
+namespace {
+
+  /// What identifies a version of a file.
+  struct file_stamp {
+    dev_t   device;
+    ino_t   inode;
+    off_t   size;
+    int64_t mtimeSec;
+    int64_t mtimeNsec;
+
+    bool operator==(const file_stamp& o) const {
+      return device == o.device && inode == o.inode && size == o.size &&
+        mtimeSec == o.mtimeSec && mtimeNsec == o.mtimeNsec;
+    }
+  };
+
+  bool stampOf(const string& path, file_stamp& stamp) {
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0) return false;
+    stamp.device = st.st_dev;
+    stamp.inode = st.st_ino;
+    stamp.size = st.st_size;
+    stamp.mtimeSec = st.st_mtim.tv_sec;
+    stamp.mtimeNsec = st.st_mtim.tv_nsec;
+    return true;
+  }
+
+  struct cache_entry {
+    file_stamp stamp;
+    std::shared_ptr<const parsed_file> file;
+  };
+
+  std::mutex cacheMutex;
+  std::unordered_map<string, cache_entry> cacheEntries;
+}
+
+parsed_file::parsed_file(const string& path)
+  : m_hasError(false),
+    m_errorLineNumber(0)
+{
+  file_mapping file;
+  if(!file.map(path)) throw file_exception(path);
+  if(file.size() == 0) return;
+
+  // the file size bounds the storage needed for keys and values
+  m_data.reserve(file.size());
+  const char* dataEnd = file.data() + file.size();
+  size_t lineNumber = 0;
+  for(const char* lineBegin = file.data(); lineBegin < dataEnd; ) {
+    const char* lineEnd = static_cast<const char*>(memchr(lineBegin, '\n', dataEnd-lineBegin));
+    if(!lineEnd) lineEnd = dataEnd;
+    lineNumber++;
+    const char* begin = lineBegin;
+    const char* end = lineEnd;
+    line_scanner::trim(begin, end);
+    if(!line_scanner::isBlankOrComment(begin, end)) {
+      line_scanner::range key, val;
+      if(line_scanner::scanKeyVal(begin, end, key, val)) {
+        add(PAIR, lineNumber, key.begin, key.end, val.begin, val.end);
+      }
+      else if(line_scanner::scanInclude(begin, end, key)) {
+        add(INCLUDE, lineNumber, key.begin, key.end, key.end, key.end);
+      }
+      else {
+        m_hasError = true;
+        m_errorLine.assign(begin, end);
+        m_errorLineNumber = lineNumber;
+        break;
+      }
+    }
+    lineBegin = lineEnd + 1;
+  }
+}
+
+void parsed_file::add(item_kind kind, size_t line, const char* keyBegin, const char* keyEnd,
+                      const char* valBegin, const char* valEnd) {
+  item it;
+  it.kind = kind;
+  it.line = line;
+  it.keyOff = m_data.size();
+  it.keyLen = keyEnd - keyBegin;
+  m_data.insert(m_data.end(), keyBegin, keyEnd);
+  it.valOff = m_data.size();
+  it.valLen = valEnd - valBegin;
+  m_data.insert(m_data.end(), valBegin, valEnd);
+  m_items.push_back(it);
+}
+
+std::shared_ptr<const parsed_file> parse_cache::get(const string& path) {
+  file_stamp before;
+  bool stamped = stampOf(path, before);
+  if(stamped) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cacheEntries.find(path);
+    if(it != cacheEntries.end() && it->second.stamp == before) return it->second.file;
+  }
+
+  // parse outside of the lock, so that several files are parsed concurrently
+  std::shared_ptr<const parsed_file> file = std::make_shared<parsed_file>(path);
+
+  // only cache the result if the file did not change while it was read
+  file_stamp after;
+  if(stamped && stampOf(path, after) && after == before) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache_entry& entry = cacheEntries[path];
+    entry.stamp = before;
+    entry.file = file;
+  }
+  return file;
+}
+
+void parse_cache::clear() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  cacheEntries.clear();
+}
+
+size_t parse_cache::size() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return cacheEntries.size();
+}
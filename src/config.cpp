@@ -2,20 +2,34 @@
 // Copyright 2013
 
 #include "config/config.hpp"
+#include "config/frozen_config.hpp"
+#include "config/private/ArrayFile.hpp"
+#include "config/private/ConfigImage.hpp"
+#include "config/private/FileMapping.hpp"
+#include "config/private/LineScanner.hpp"
+#include "config/private/ListScanner.hpp"
+#include "config/private/ParsedFile.hpp"
 
-#ifdef USE_BOOST_REGEX
-#include <boost/regex.hpp>
-#else
-#include <regex>
-#endif
-
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
 #include <fstream>
 #include <sstream>
+#ifdef CONFIG_INSTRUMENTATION
+#include <map>
+#include <mutex>
+#include <set>
+#endif
+#include <thread>
 #include <boost/filesystem.hpp>
-
-// Character indicating a line comment
-#define COMMENTCHAR '#'
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 using std::string;
 using std::vector;
@@ -23,17 +37,266 @@ using std::ifstream;
 using std::stringstream;
 using boost::filesystem::path;
 
-#ifdef USE_BOOST_REGEX
-using boost::regex;
-using boost::regex_search;
-using boost::smatch;
-#else
-using std::regex;
-using std::regex_search;
-using std::smatch;
-#endif
+namespace {
+  /**
+   * The end value of a sequence of real numbers is included if it is
+   * within this fraction of a step of an element, so that rounding
+   * errors do not drop it.
+   */
+  const double SEQ_END_TOLERANCE = 1e-9;
+
+  /// Sequences of real numbers cannot have more elements than this.
+  const double SEQ_MAX_STEPS = 9007199254740992.0; // 2^53
+
+  /// Returns the number of digits at the start of [p, end).
+  inline size_t digitRun(const char* p, const char* end) {
+    const char* q = p;
+    while(q < end && *q >= '0' && *q <= '9') q++;
+    return q - p;
+  }
+
+  /**
+   * Matches a number of the form <digits>[.<digits>] at "p".
+   *@return The end of the number, or 0 if there is none.
+   */
+  const char* scanDecimal(const char* p, const char* end) {
+    size_t n = digitRun(p, end);
+    if(n == 0) return 0;
+    p += n;
+    if(p < end && *p == '.') {
+      size_t frac = digitRun(p+1, end);
+      if(frac > 0) p += 1 + frac;
+    }
+    return p;
+  }
+
+  /// Copies the elements of an array file into a list.
+  template<class T>
+  void copyArray(const array_file& array, vector<T>& values) {
+    values.resize(array.size());
+    array.copyTo(values.data(), values.size());
+  }
+
+  void copyArray(const array_file& array, vector<string>& values) {
+    array.copyTo(values);
+  }
+
+  /**
+   * Path of the file included by "includePath" from the configuration
+   * file "filepath": a relative path is resolved from the directory of
+   * the including file.
+   */
+  string resolveInclude(std::string_view includePath, const string& filepath) {
+    path p{string(includePath)};
+    if(p.is_absolute()) return p.string();
+    return (path(filepath).parent_path() / p).string();
+  }
+
+  /// Canonical form of "filepath", used to recognize the same file.
+  string canonicalPath(const string& filepath) {
+    boost::system::error_code ec;
+    path p = boost::filesystem::weakly_canonical(filepath, ec);
+    return ec ? filepath : p.string();
+  }
+
+  /**
+   * Throws a syntax_exception if the file with canonical path
+   * "canonical", included at line "lineNumber" of "filepath", is
+   * already being loaded.
+   */
+  void checkIncludeCycle(const string& canonical, const vector<string>& includeStack,
+                         const string& filepath, size_t lineNumber) {
+    vector<string>::const_iterator it =
+      std::find(includeStack.begin(), includeStack.end(), canonical);
+    if(it == includeStack.end()) return;
+    string cycle = "include cycle: ";
+    for(; it != includeStack.end(); ++it) cycle += *it + " -> ";
+    throw syntax_exception(cycle + canonical, filepath, lineNumber);
+  }
+
+  /// Closes a file descriptor when going out of scope.
+  struct fd_closer {
+    explicit fd_closer(int fd) : m_fd(fd) {}
+    ~fd_closer() { close(m_fd); }
+    int m_fd;
+  };
+
+  /**
+   * Reads the open file "fd" (at "filepath") in chunks of "chunkSize"
+   * bytes, and calls "f(begin, end, lineNumber)" for each trimmed line
+   * that is not blank or a comment. The line is only valid during the
+   * call. Memory use is bounded by the chunk size, or by the longest
+   * line if it is longer.
+   *@throws file_exception  If the file cannot be read.
+   */
+  template<class F>
+  void forEachLine(int fd, const string& filepath, size_t chunkSize, F f) {
+    vector<char> buffer(chunkSize);
+    size_t filled = 0;  // bytes in the buffer
+    size_t lineNumber = 0;
+    bool eof = false;
+    while(!eof) {
+      // a line longer than the buffer: make room for it
+      if(filled == buffer.size()) buffer.resize(2 * buffer.size());
+      ssize_t n = read(fd, buffer.data() + filled, buffer.size() - filled);
+      if(n < 0) {
+        if(errno == EINTR) continue;
+        throw file_exception(filepath);
+      }
+      eof = (n == 0);
+      filled += n;
+
+      // handle the complete lines (and the last line at the end of file)
+      const char* dataEnd = buffer.data() + filled;
+      const char* lineBegin = buffer.data();
+      while(lineBegin < dataEnd) {
+        const char* lineEnd = static_cast<const char*>(memchr(lineBegin, '\n', dataEnd-lineBegin));
+        if(!lineEnd) {
+          if(!eof) break;
+          lineEnd = dataEnd;
+        }
+        lineNumber++;
+        const char* begin = lineBegin;
+        const char* end = lineEnd;
+        line_scanner::trim(begin, end);
+        if(!line_scanner::isBlankOrComment(begin, end)) f(begin, end, lineNumber);
+        lineBegin = lineEnd + 1;
+      }
+
+      // keep the incomplete last line for the next chunk
+      size_t consumed = lineBegin < dataEnd ? lineBegin - buffer.data() : filled;
+      memmove(buffer.data(), buffer.data() + consumed, filled - consumed);
+      filled -= consumed;
+    }
+  }
+
+  /**
+   * Expands the references of the values of an arg_table (see
+   * config::interpolate()). Each value is expanded at most once, after
+   * the values it refers to.
+   */
+  class interpolator {
+  public:
+    /**
+     * The entries of "expanded" (values stored by a previous expansion)
+     * whose value is unchanged are not expanded again.
+     */
+    interpolator(const arg_table& table,
+                 const std::map<arg_table::id_type, string>& expanded)
+      : m_table(table), m_states(table.size(), UNVISITED), m_expanded(table.size())
+    {
+      std::map<arg_table::id_type, string>::const_iterator it;
+      for(it = expanded.begin(); it != expanded.end(); ++it) {
+        if(it->first < table.size() && table.value(it->first) == it->second)
+          m_states[it->first] = UNCHANGED;
+      }
+    }
+
+    /**
+     * Returns true if the value of entry "id" contains references (or
+     * escapes), and sets "out" to its expansion.
+     */
+    bool expand(arg_table::id_type id, const string*& out) {
+      visit(id);
+      out = &m_expanded[id];
+      return m_states[id] == EXPANDED;
+    }
+
+  private:
+    enum state { UNVISITED, VISITING, UNCHANGED, EXPANDED };
+
+    static bool hasReference(std::string_view val) {
+      return val.find("${") != std::string_view::npos;
+    }
+
+    void visit(arg_table::id_type id) {
+      if(m_states[id] == UNCHANGED || m_states[id] == EXPANDED) return;
+      if(m_states[id] == VISITING) throwCycle(id);
+      std::string_view val = m_table.value(id);
+      if(!hasReference(val)) {
+        m_states[id] = UNCHANGED;
+        return;
+      }
+      m_states[id] = VISITING;
+      m_chain.push_back(id);
+      string& out = m_expanded[id];
+      size_t pos = 0;
+      while(pos < val.size()) {
+        size_t ref = val.find('$', pos);
+        if(ref == std::string_view::npos) break;
+        out.append(val.data() + pos, ref - pos);
+        // "$${" is a literal "${"
+        if(val.compare(ref, 3, "$${") == 0) {
+          out += "${";
+          pos = ref + 3;
+          continue;
+        }
+        if(val.compare(ref, 2, "${") != 0) {
+          out += '$';
+          pos = ref + 1;
+          continue;
+        }
+        size_t close = val.find('}', ref + 2);
+        if(close == std::string_view::npos) throw syntax_exception(string(val));
+        appendReference(val.substr(ref + 2, close - ref - 2), out);
+        pos = close + 1;
+      }
+      if(pos < val.size()) out.append(val.data() + pos, val.size() - pos);
+      m_chain.pop_back();
+      m_states[id] = EXPANDED;
+    }
+
+    void appendReference(std::string_view name, string& out) {
+      if(name.compare(0, 4, "env:") == 0) {
+        const char* env = getenv(string(name.substr(4)).c_str());
+        if(!env) throw key_not_found(string(name));
+        out += env;
+        return;
+      }
+      arg_table::id_type ref = m_table.find(name);
+      if(ref == arg_table::npos) throw key_not_found(string(name));
+      visit(ref);
+      if(m_states[ref] == EXPANDED) out += m_expanded[ref];
+      else out += m_table.value(ref);
+    }
+
+    void throwCycle(arg_table::id_type id) {
+      string cycle = "interpolation cycle: ";
+      vector<arg_table::id_type>::const_iterator it =
+        std::find(m_chain.begin(), m_chain.end(), id);
+      for(; it != m_chain.end(); ++it) cycle += string(m_table.key(*it)) + " -> ";
+      throw syntax_exception(cycle + string(m_table.key(id)));
+    }
+
+    const arg_table& m_table;
+    vector<state> m_states;
+    vector<string> m_expanded;
+    /// Entries being expanded, the outermost first.
+    vector<arg_table::id_type> m_chain;
+  };
+
+  /**
+   * Clears the typed-value cache of a config, and drops the snapshot it
+   * was loaded from, when a loading function returns or throws, since
+   * values may have been added or replaced.
+   */
+  class cache_invalidator {
+  public:
+    cache_invalidator(typed_cache& cache, const arg_table& table,
+                      std::shared_ptr<const mapped_image>& snapshot)
+      : m_cache(cache), m_table(table), m_snapshot(snapshot) {}
 
-const string config::keyValRegex= "([[:alpha:][:digit:]_:-]+)[[:space:]]*=[[:space:]]*(.+)";
+    ~cache_invalidator() {
+      m_cache.reset(m_table.size());
+      m_snapshot.reset();
+    }
+
+  private:
+    typed_cache& m_cache;
+    const arg_table& m_table;
+    std::shared_ptr<const mapped_image>& m_snapshot;
+  };
+}
 
 config::config()
   : m_checkKeys(false),
@@ -42,350 +305,1296 @@ config::config()
 {}
 
 void config::initCL(int argc, char** argv) {
-  for(uint i=1; i<argc; i++) {
-    string s(argv[i]);
-    smatch tokens; // will return the matches as std::string objects
-
-    const string optionRegex= "--([[:alpha:][:digit:]_-]+)[[:space:]]*$"; // double [[ is required
-
-#ifdef USE_BOOST_REGEX
-    regex r(keyValRegex, boost::regex::extended);
-    regex r2(optionRegex, boost::regex::extended);
-#else
-    regex r(keyValRegex);
-    regex r2(optionRegex); 
-#endif
-    
-    if(regex_search(s, tokens, r)) {
-      string key = tokens[1];
-      if(m_checkKeys && (m_validKeys.find(key) == m_validKeys.cend()))
-        throw invalidkey_exception(key);
-      m_argMap[ key ] = tokens[2];
-    }
-    else if(regex_search(s, tokens, r2)) {
-      string option = tokens[1];
-      if(m_checkKeys && (m_validOptions.find(option) == m_validOptions.cend()))
-        throw invalidkey_exception(option);
-      m_argMap[ option ] = "";
-    }
-    else {
-      throw syntax_exception(s);
+  cache_invalidator invalidator(m_cache, m_argMap, m_snapshot);
+  // size the table once for all the arguments
+  size_t nbBytes = 0;
+  for(int i=1; i<argc; i++) nbBytes += strlen(argv[i]);
+  m_argMap.reserve(argc, nbBytes);
+
+  vector<string> responseStack;
+  for(int i=1; i<argc; i++) {
+    const char* begin = argv[i];
+    const char* end = begin + strlen(begin);
+    if(*begin == RESPONSE_FILE_CHAR && end - begin > 1) {
+      initResponseFile(string(begin+1, end), "", 0, responseStack);
+    } else {
+      setArgument(begin, end, "", 0, NO_SOURCE);
     }
   }
 }
 
 void config::initFile(string filepath, bool keepExisting) {
+  cache_invalidator invalidator(m_cache, m_argMap, m_snapshot);
   m_filePath = filepath;
+  uint32_t source = addSourceFile(filepath);
   path p(filepath);
   m_fileName = p.filename().string();
   ifstream ifs(filepath.c_str());
   if(!ifs.good()) throw file_exception(filepath);
 
+  vector<string> includeStack(1, canonicalPath(filepath));
   string curLine;
-  while(ifs.good()) {
-    getline_nc(ifs, curLine);
-    if(curLine != "") {
-      // similar code as in initCL(...)
-      smatch tokens; // will return the matches as std::string objects
-
-#ifdef USE_BOOST_REGEX
-      regex r(keyValRegex, boost::regex::extended);
-#else
-      regex r(keyValRegex);
-#endif
-      if(regex_search(curLine, tokens, r)) {
-        string key = tokens[1];
-        if(m_checkKeys && (m_validKeys.find(key) == m_validKeys.cend()))
-          throw invalidkey_exception(key);
-        string val = tokens[2];
-        // only register the new value if the key does not already exist or if
-        // we are overwritting existing keys
-        if(!keepExisting || m_argMap.find(key) == m_argMap.cend()) {
-	        m_argMap[ key ] = val;
-        }
-      }
-      else {
-        throw syntax_exception(curLine);
+  size_t lineNumber = 0;
+  while(std::getline(ifs, curLine)) {
+    lineNumber++;
+    const char* begin = curLine.data();
+    const char* end = begin + curLine.size();
+    line_scanner::trim(begin, end);
+    if(line_scanner::isBlankOrComment(begin, end)) continue;
+    line_scanner::range key, val;
+    if(scanLine(begin, end, key, val, filepath, lineNumber)) {
+      setEntry(std::string_view(key.begin, key.size()),
+               std::string_view(val.begin, val.size()), !keepExisting, source);
+    } else {
+      includeFile(std::string_view(key.begin, key.size()), filepath, lineNumber,
+                  keepExisting, includeStack);
+    }
+  }
+}
+
+void config::initFileMapped(string filepath, bool keepExisting) {
+  cache_invalidator invalidator(m_cache, m_argMap, m_snapshot);
+  m_filePath = filepath;
+  uint32_t source = addSourceFile(filepath);
+  path p(filepath);
+  m_fileName = p.filename().string();
+
+  file_mapping file;
+  if(!file.map(filepath)) throw file_exception(filepath);
+  if(file.size() == 0) return;
+  madvise(const_cast<char*>(file.data()), file.size(), MADV_SEQUENTIAL);
+
+  const char* dataEnd = file.data() + file.size();
+  // the file size bounds the storage needed for keys and values
+  m_argMap.reserve(0, file.size());
+  vector<string> includeStack(1, canonicalPath(filepath));
+  size_t lineNumber = 0;
+  for(const char* lineBegin = file.data(); lineBegin < dataEnd; ) {
+    const char* lineEnd = static_cast<const char*>(memchr(lineBegin, '\n', dataEnd-lineBegin));
+    if(!lineEnd) lineEnd = dataEnd;
+    lineNumber++;
+    const char* begin = lineBegin;
+    const char* end = lineEnd;
+    line_scanner::trim(begin, end);
+    if(!line_scanner::isBlankOrComment(begin, end)) {
+      line_scanner::range key, val;
+      if(scanLine(begin, end, key, val, filepath, lineNumber)) {
+        setEntry(std::string_view(key.begin, key.size()),
+                 std::string_view(val.begin, val.size()), !keepExisting, source);
+      } else {
+        includeFile(std::string_view(key.begin, key.size()), filepath, lineNumber,
+                    keepExisting, includeStack);
       }
     }
+    lineBegin = lineEnd + 1;
   }
 }
 
-uint config::parseParamUInt(string key) const {
-  auto it = m_argMap.find(key);
-  if(it != m_argMap.end()) return atoi(it->second.c_str());
-  else {
-    throw key_not_found(key);
+void config::initFiles(const vector<string>& filepaths, bool keepExisting) {
+  size_t nbFiles = filepaths.size();
+  vector<std::shared_ptr<const parsed_file>> files(nbFiles);
+  vector<std::exception_ptr> errors(nbFiles);
+
+  // tokenize the files on a pool of threads
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    for(size_t i = next++; i < nbFiles; i = next++) {
+      try { files[i] = parse_cache::get(filepaths[i]); }
+      catch(...) { errors[i] = std::current_exception(); }
+    }
+  };
+  size_t nbThreads = std::min<size_t>(std::thread::hardware_concurrency(), nbFiles);
+  vector<std::thread> pool;
+  for(size_t t = 1; t < nbThreads; t++) pool.push_back(std::thread(work));
+  work();
+  for(size_t t = 0; t < pool.size(); t++) pool[t].join();
+
+  // merge in order, stopping where the sequential loads would have
+  cache_invalidator invalidator(m_cache, m_argMap, m_snapshot);
+  size_t nbBytes = 0;
+  for(size_t i = 0; i < nbFiles; i++) {
+    if(files[i]) nbBytes += files[i]->dataSize() + 2 * files[i]->size();
+  }
+  m_argMap.reserve(0, nbBytes);
+  for(size_t i = 0; i < nbFiles; i++) {
+    m_filePath = filepaths[i];
+    m_fileName = path(filepaths[i]).filename().string();
+    if(errors[i]) std::rethrow_exception(errors[i]);
+    uint32_t source = addSourceFile(filepaths[i]);
+    vector<string> includeStack(1, canonicalPath(filepaths[i]));
+    applyFile(*files[i], filepaths[i], source, keepExisting, includeStack);
   }
 }
 
-double config::parseParamDouble(string key) const {
-  auto it = m_argMap.find(key);
-  if(it != m_argMap.end()) return atof(it->second.c_str());
-  else {
-    throw key_not_found(key);
+void config::clearParseCache() {
+  parse_cache::clear();
+}
+
+bool config::scanLine(const char* begin, const char* end,
+                      line_scanner::range& key, line_scanner::range& val,
+                      const string& filepath, size_t lineNumber) const {
+  // similar code as in initCL(...)
+  if(!line_scanner::scanKeyVal(begin, end, key, val)) {
+    if(line_scanner::scanInclude(begin, end, key)) return false;
+    throw syntax_exception(string(begin, end), filepath, lineNumber);
   }
+  std::string_view keyStr(key.begin, key.size());
+  if(m_checkKeys && (m_validKeys.find(keyStr) == arg_table::npos))
+    throw invalidkey_exception(string(keyStr), filepath, lineNumber);
+  return true;
 }
 
-bool config::parseParamBool(string key) const {
-  auto it = m_argMap.find(key);
-  if(it != m_argMap.end()) {
-    if(it->second == "1" || it->second == "true") return true;
-    else return false;
+void config::includeFile(std::string_view includePath, const string& filepath,
+                         size_t lineNumber, bool keepExisting,
+                         vector<string>& includeStack) {
+  string included = resolveInclude(includePath, filepath);
+  string canonical = canonicalPath(included);
+  checkIncludeCycle(canonical, includeStack, filepath, lineNumber);
+  std::shared_ptr<const parsed_file> file;
+  try {
+    file = parse_cache::get(canonical);
+  } catch(file_exception&) {
+    throw file_exception(included, filepath, lineNumber);
   }
-  else {
-    throw key_not_found(key);
+  // the pairs of the included file are attributed to it, not to "filepath"
+  uint32_t source = addSourceFile(canonical);
+  includeStack.push_back(canonical);
+  applyFile(*file, included, source, keepExisting, includeStack);
+  includeStack.pop_back();
+}
+
+void config::applyFile(const parsed_file& file, const string& filepath,
+                       uint32_t source, bool keepExisting,
+                       vector<string>& includeStack) {
+  for(size_t i = 0; i < file.size(); i++) {
+    if(file.kind(i) == parsed_file::INCLUDE) {
+      includeFile(file.key(i), filepath, file.lineNumber(i), keepExisting, includeStack);
+      continue;
+    }
+    std::string_view key = file.key(i);
+    if(m_checkKeys && (m_validKeys.find(key) == arg_table::npos))
+      throw invalidkey_exception(string(key), filepath, file.lineNumber(i));
+    setEntry(key, file.value(i), !keepExisting, source);
   }
+  if(file.hasSyntaxError())
+    throw syntax_exception(file.errorLine(), filepath, file.errorLineNumber());
+}
+
+size_t config::streamFile(string filepath, stream_callback callback,
+                          size_t chunkSize) const {
+  int fd = open(filepath.c_str(), O_RDONLY);
+  if(fd < 0) throw file_exception(filepath);
+  vector<string> includeStack(1, canonicalPath(filepath));
+  return streamFile(fd, filepath, callback, chunkSize, includeStack);
+}
+
+size_t config::streamFile(int fd, const string& filepath,
+                          const stream_callback& callback, size_t chunkSize,
+                          vector<string>& includeStack) const {
+  fd_closer closer(fd);
+
+  if(chunkSize == 0) chunkSize = STREAM_CHUNK_SIZE;
+  size_t nbPairs = 0;
+  forEachLine(fd, filepath, chunkSize, [&](const char* begin, const char* end, size_t lineNumber) {
+      line_scanner::range key, val;
+      if(scanLine(begin, end, key, val, filepath, lineNumber)) {
+        nbPairs++;
+        if(!callback) return;
+        try {
+          callback(std::string_view(key.begin, key.size()),
+                   std::string_view(val.begin, val.size()));
+        }
+        // errors found by the callback are located at the current line
+        catch(syntax_exception& e) {
+          if(!e.location().empty()) throw;
+          throw syntax_exception(e.what(), filepath, lineNumber);
+        }
+        catch(invalidkey_exception& e) {
+          if(!e.location().empty()) throw;
+          throw invalidkey_exception(e.what(), filepath, lineNumber);
+        }
+      } else {
+        string included = resolveInclude(std::string_view(key.begin, key.size()), filepath);
+        string canonical = canonicalPath(included);
+        checkIncludeCycle(canonical, includeStack, filepath, lineNumber);
+        int includedFd = open(canonical.c_str(), O_RDONLY);
+        if(includedFd < 0) throw file_exception(included, filepath, lineNumber);
+        includeStack.push_back(canonical);
+        nbPairs += streamFile(includedFd, included, callback, chunkSize, includeStack);
+        includeStack.pop_back();
+      }
+    });
+  return nbPairs;
 }
 
-string config::getParamString(string key) const {
-  auto it = m_argMap.find(key);
-  if(it != m_argMap.end()) {
-    return it->second;
+size_t config::interpolate() {
+  // expand everything before modifying the table, which moves its values
+  interpolator expander(m_argMap, m_literalRefs);
+  vector<std::pair<arg_table::id_type, const string*>> changes;
+  for(arg_table::id_type id=0; id<m_argMap.size(); id++) {
+    const string* expanded;
+    if(expander.expand(id, expanded)) changes.push_back(std::make_pair(id, expanded));
   }
-  else {
-    throw key_not_found(key);
+  if(changes.empty()) return 0;
+
+  cache_invalidator invalidator(m_cache, m_argMap, m_snapshot);
+  for(size_t i=0; i<changes.size(); i++) {
+    string key(m_argMap.key(changes[i].first));
+    m_argMap.set(key, *changes[i].second);
+    // a literal "${" (from "$${") must not be expanded by the next call
+    if(changes[i].second->find("${") != string::npos)
+      m_literalRefs[changes[i].first] = *changes[i].second;
+    else
+      m_literalRefs.erase(changes[i].first);
   }
+  return changes.size();
 }
 
-bool config::checkOption(string key) const {
-  auto it = m_argMap.find(key);
-  if(it != m_argMap.end()) return true;
-  return false;
+void config::saveSnapshot(string filepath) const {
+  image_builder builder(m_argMap);
+  buildImage(builder);
+  builder.setSourcePath(m_filePath);
+  for(size_t i=0; i<m_sourceFiles.size(); i++) {
+    image_source source;
+    if(!image_source::stat(m_sourceFiles[i], source, true))
+      throw file_exception(m_sourceFiles[i]);
+    builder.addStamp(source);
+  }
+  vector<char> image = builder.finish();
+
+  // Write to a temporary file that is then renamed, so that processes
+  // loading the snapshot never see a partially written file.
+  string tmpPath = filepath + ".tmp" + std::to_string(getpid());
+  std::ofstream ofs(tmpPath.c_str(), std::ios::binary);
+  ofs.write(image.data(), image.size());
+  ofs.close();
+  if(!ofs || rename(tmpPath.c_str(), filepath.c_str()) != 0) {
+    unlink(tmpPath.c_str());
+    throw file_exception(filepath);
+  }
 }
 
-bool config::sequenceParser(string key, vector<uint>& seqReturn) const {
-  auto it = m_argMap.find(key);
-  if(it == m_argMap.end()) throw key_not_found(key);
+void config::loadSnapshot(string filepath) {
+  std::shared_ptr<mapped_image> image = std::make_shared<mapped_image>();
+  if(!image->file.map(filepath)) throw file_exception(filepath);
+  const image_view& view = image->view;
+  if(!image->view.attach(image->file.data(), image->file.size()))
+    throw snapshot_exception(filepath);
+  const image_header& header = view.header();
 
-  seqReturn.clear();
-  int start, incr, end;
+  // reject the snapshot if a source file has changed since it was saved
+  if(!view.isFresh()) throw snapshot_exception(filepath);
 
-  smatch tokens;
-  const string seqRegex= "([[:digit:]]+):([[:digit:]]+):([[:digit:]]+)";
-#ifdef USE_BOOST_REGEX
-  regex r(seqRegex, boost::regex::extended);
-#else
-  regex r(seqRegex);
-#endif
-  if(regex_search(it->second, tokens, r)) {
-    string s1(tokens[1]);
-    string s2(tokens[2]);
-    string s3(tokens[3]);
-    start = atoi(s1.c_str());
-    incr  = atoi(s2.c_str());
-    end   = atoi(s3.c_str());
-  } else {
-    return false; // invalid syntax
-  }
-
-  // generate sequence
-  if(incr==0) {
-    seqReturn.push_back(start);
-  } else if(incr>0) {
-    if(end < start) return false;
-    for(int i=start; i<=end; i+= incr) {
-      seqReturn.push_back(i);
-    }
-  } else { //incr<0
-    if(start < end) return false;
-    for(int i=start; i>=end; i+= incr) {
-      seqReturn.push_back(i);
+  if(m_checkKeys) {
+    for(arg_table::id_type id=0; id<view.size(); id++) {
+      std::string_view key = view.key(id);
+      if(m_validKeys.find(key) == arg_table::npos &&
+         m_validOptions.find(key) == arg_table::npos)
+        throw invalidkey_exception(string(key));
     }
   }
+
+  m_argMap.assign(view.arena(), header.arenaSize, view.entries(), header.nbEntries,
+                  view.slots(), header.nbSlots);
+  m_literalRefs.clear();
+  m_cache.reset(m_argMap.size());
+  // typed values are copied from the mapped image as they are requested
+  m_snapshot = image;
+
+  string sourcePath(view.sourcePath());
+  m_filePath = sourcePath;
+  m_fileName = path(sourcePath).filename().string();
+  m_sourceFiles.clear();
+  for(size_t i=0; i<view.nbStamps(); i++) m_sourceFiles.push_back(string(view.stampPath(i)));
+  m_entrySources.assign(view.size(), NO_SOURCE);
+  for(arg_table::id_type id=0; id<view.size(); id++) {
+    uint32_t source = view.record(id).source;
+    if(source < m_sourceFiles.size()) m_entrySources[id] = source;
+  }
+}
+
+std::shared_ptr<const frozen_config> config::freeze() const {
+  image_builder builder(m_argMap);
+  buildImage(builder);
+  // only the paths of the source files are kept
+  builder.setSourcePath(m_filePath);
+  for(size_t i=0; i<m_sourceFiles.size(); i++) {
+    image_source source;
+    source.path = m_sourceFiles[i];
+    builder.addStamp(source);
+  }
+  return std::shared_ptr<const frozen_config>(new frozen_config(builder.finish()));
+}
+
+config::handle config::resolve(std::string_view key) const {
+  arg_table::id_type id = lookup(key);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, RESOLVE);
+  return handle(id);
+}
+
+uint config::parseParamUInt(std::string_view key) const {
+  return parseParamUInt(handle(lookup(key)));
+}
+
+uint config::parseParamUInt(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, PARSE_UINT);
+  return cachedUInt(h.m_id);
+}
+
+double config::parseParamDouble(std::string_view key) const {
+  return parseParamDouble(handle(lookup(key)));
+}
+
+double config::parseParamDouble(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, PARSE_DOUBLE);
+  return cachedDouble(h.m_id);
+}
+
+bool config::parseParamBool(std::string_view key) const {
+  return parseParamBool(handle(lookup(key)));
+}
+
+bool config::parseParamBool(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, PARSE_BOOL);
+  return cachedBool(h.m_id);
+}
+
+string config::getParamString(std::string_view key) const {
+  return getParamString(handle(lookup(key)));
+}
+
+string config::getParamString(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, GET_STRING);
+  return string(m_argMap.value(h.m_id));
+}
+
+std::string_view config::getParamView(std::string_view key) const {
+  return getParamView(handle(lookup(key)));
+}
+
+std::string_view config::getParamView(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, GET_VIEW);
+  return m_argMap.value(h.m_id);
+}
+
+bool config::checkOption(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return false;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, CHECK_OPTION);
   return true;
 }
 
-bool config::sequenceParser(string key, vector<double>& seqReturn) const {
-  auto it = m_argMap.find(key);
-  if(it == m_argMap.end()) throw key_not_found(key);
+seq_range<uint> config::getUIntRange(std::string_view key) const {
+  return getUIntRange(handle(lookup(key)));
+}
 
-  seqReturn.clear();
+seq_range<uint> config::getUIntRange(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, RANGE);
+  const parsed_range<uint>& range = cachedRange<uint>(h.m_id, typed_cache::RANGE_UINT);
+  if(!range.valid) throwSyntax(h.m_id);
+  return range.range;
+}
 
-  // exponential sequence syntax: <start>*<multiplier>:<end>
-  const string expSeqRegex= "^([[:digit:]]+(\\.[[:digit:]]+)?)\\*([[:digit:]]+(\\.[[:digit:]]+)?):([[:digit:]]+(\\.[[:digit:]]+)?)$";
-  // linear sequence syntax: <start>:<incr>:<end>
-  const string linSeqRegex= "^([[:digit:]]+(\\.[[:digit:]]+)?):([[:digit:]]+(\\.[[:digit:]]+)?):([[:digit:]]+(\\.[[:digit:]]+)?)$";
-  
-#ifdef USE_BOOST_REGEX
-  regex r(expSeqRegex, boost::regex::extended);
-  regex r2(linSeqRegex, boost::regex::extended);
-#else
-  regex r(expSeqRegex);
-  regex r2(linSeqRegex);
-#endif
+seq_range<double> config::getDoubleRange(std::string_view key) const {
+  return getDoubleRange(handle(lookup(key)));
+}
 
-  smatch tokens;
-  if(regex_search(it->second, tokens, r)) {
-    // exponential sequence
-    string s1(tokens[1]);
-    string s2(tokens[3]);
-    string s3(tokens[5]);
-    double start = atof(s1.c_str());
-    double mult  = atof(s2.c_str());
-    double end   = atof(s3.c_str());
-
-    // generate sequence
-    if(mult<=0) return false;
-    for(double x=start; x<=end; x*= mult) {
-      seqReturn.push_back(x);
-    }
-    return true;
-  } else if(regex_search(it->second, tokens, r2)) {
-    // linear sequence
-    string s1(tokens[1]);
-    string s2(tokens[3]);
-    string s3(tokens[5]);
-    double start = atof(s1.c_str());
-    double incr  = atof(s2.c_str());
-    double end   = atof(s3.c_str());
-
-    // generate sequence
-    if(incr==0) {
-      seqReturn.push_back(start);
-    } else if(incr>0) {
-      if(end < start) return false;
-      for(double x=start; x<=end; x+= incr) {
-        seqReturn.push_back(x);
-      }
-    } else { //incr<0
-      if(start < end) return false;
-      for(double x=start; x>=end; x+= incr) {
-        seqReturn.push_back(x);
-      }
-    }
-    return true;
-  } else {
-    // invalid syntax
-    return false;
+seq_range<double> config::getDoubleRange(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, RANGE);
+  const parsed_range<double>& range = cachedRange<double>(h.m_id, typed_cache::RANGE_DOUBLE);
+  if(!range.valid) throwSyntax(h.m_id);
+  return range.range;
+}
+
+bool config::sequenceParser(std::string_view key, vector<uint>& seqReturn) const {
+  return sequenceParser(handle(lookup(key)), seqReturn);
+}
+
+bool config::sequenceParser(handle h, vector<uint>& seqReturn) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, SEQUENCE);
+  const parsed_range<uint>& range = cachedRange<uint>(h.m_id, typed_cache::RANGE_UINT);
+  seqReturn = range.range.vector();
+  return range.valid;
+}
+
+bool config::sequenceParser(std::string_view key, vector<double>& seqReturn) const {
+  return sequenceParser(handle(lookup(key)), seqReturn);
+}
+
+bool config::sequenceParser(handle h, vector<double>& seqReturn) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, SEQUENCE);
+  const parsed_range<double>& range = cachedRange<double>(h.m_id, typed_cache::RANGE_DOUBLE);
+  seqReturn = range.range.vector();
+  return range.valid;
+}
+
+bool config::listParser(std::string_view key, vector<int>& listReturn) const {
+  return listParser(handle(lookup(key)), listReturn);
+}
+
+bool config::listParser(handle h, vector<int>& listReturn) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, LIST);
+  const parsed_list<int>& list = cachedList<int>(h.m_id, typed_cache::LIST_INT);
+  listReturn = list.values;
+  return list.valid;
+}
+
+bool config::listParser(std::string_view key, vector<double>& listReturn) const {
+  return listParser(handle(lookup(key)), listReturn);
+}
+
+bool config::listParser(handle h, vector<double>& listReturn) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, LIST);
+  const parsed_list<double>& list = cachedList<double>(h.m_id, typed_cache::LIST_DOUBLE);
+  listReturn = list.values;
+  return list.valid;
+}
+
+bool config::listParser(std::string_view key, vector<string>& listReturn) const {
+  return listParser(handle(lookup(key)), listReturn);
+}
+
+bool config::listParser(handle h, vector<string>& listReturn) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, LIST);
+  const parsed_list<string>& list = cachedList<string>(h.m_id, typed_cache::LIST_STRING);
+  listReturn = list.values;
+  return list.valid;
+}
+
+size_t config::listSize(std::string_view key) const {
+  return listSize(handle(lookup(key)));
+}
+
+size_t config::listSize(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, LIST_SIZE);
+  if(array_file::isReference(m_argMap.value(h.m_id))) return cachedArray(h.m_id).size();
+  line_scanner::range content = listContent(h.m_id);
+  CONFIG_TIME_PARSE(m_cache.stats(), h.m_id);
+  return list_scanner::count(content.begin, content.end);
+}
+
+size_t config::listParser(std::string_view key, int* out, size_t capacity) const {
+  return listParser(handle(lookup(key)), out, capacity);
+}
+
+size_t config::listParser(handle h, int* out, size_t capacity) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, LIST);
+  if(array_file::isReference(m_argMap.value(h.m_id))) {
+    const array_file& array = cachedArray(h.m_id);
+    CONFIG_TIME_PARSE(m_cache.stats(), h.m_id);
+    array.copyTo(out, capacity);
+    return array.size();
+  }
+  line_scanner::range content = listContent(h.m_id);
+  CONFIG_TIME_PARSE(m_cache.stats(), h.m_id);
+  return list_scanner::parse(content.begin, content.end, out, capacity);
+}
+
+size_t config::listParser(std::string_view key, double* out, size_t capacity) const {
+  return listParser(handle(lookup(key)), out, capacity);
+}
+
+size_t config::listParser(handle h, double* out, size_t capacity) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, LIST);
+  if(array_file::isReference(m_argMap.value(h.m_id))) {
+    const array_file& array = cachedArray(h.m_id);
+    CONFIG_TIME_PARSE(m_cache.stats(), h.m_id);
+    array.copyTo(out, capacity);
+    return array.size();
   }
+  line_scanner::range content = listContent(h.m_id);
+  CONFIG_TIME_PARSE(m_cache.stats(), h.m_id);
+  return list_scanner::parse(content.begin, content.end, out, capacity);
 }
 
-bool config::listParser(string key, vector<int>& listReturn) const {
-  auto it = m_argMap.find(key);
-  if(it == m_argMap.end()) throw key_not_found(key);
+array_view<double> config::getDoubleArray(std::string_view key) const {
+  return getDoubleArray(handle(lookup(key)));
+}
 
-  listReturn.clear();
+array_view<double> config::getDoubleArray(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, ARRAY);
+  return typedArray<double>(h.m_id, array_file::F64);
+}
+
+array_view<float> config::getFloatArray(std::string_view key) const {
+  return getFloatArray(handle(lookup(key)));
+}
+
+array_view<float> config::getFloatArray(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, ARRAY);
+  return typedArray<float>(h.m_id, array_file::F32);
+}
 
-  // check for, and then remove, the curly brackets
-  regex r("\\{(.+)\\}");
-  smatch regexMatch;
-  string rawString= it->second;
-  if(regex_search(rawString, regexMatch, r)) {
-    vector<string> tokens;
-    // the first element in regexMatch is the whole expression, while
-    // regexMatch[1] contains the expression within parentheses.
-    tokens = split(regexMatch[1], ',', tokens);
-    for(int i=0; i<tokens.size(); i++) {
-      listReturn.push_back(atoi(tokens[i].c_str()));
+array_view<int64_t> config::getInt64Array(std::string_view key) const {
+  return getInt64Array(handle(lookup(key)));
+}
+
+array_view<int64_t> config::getInt64Array(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, ARRAY);
+  return typedArray<int64_t>(h.m_id, array_file::I64);
+}
+
+array_view<int32_t> config::getInt32Array(std::string_view key) const {
+  return getInt32Array(handle(lookup(key)));
+}
+
+array_view<int32_t> config::getInt32Array(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, ARRAY);
+  return typedArray<int32_t>(h.m_id, array_file::I32);
+}
+
+const vector<uint>& config::getUIntSequence(std::string_view key) const {
+  return getUIntSequence(handle(lookup(key)));
+}
+
+const vector<uint>& config::getUIntSequence(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, SEQUENCE);
+  const parsed_list<uint>& seq = cachedSequence<uint>(h.m_id, typed_cache::SEQ_UINT,
+                                                       typed_cache::RANGE_UINT);
+  if(!seq.valid) throwSyntax(h.m_id);
+  return seq.values;
+}
+
+const vector<double>& config::getDoubleSequence(std::string_view key) const {
+  return getDoubleSequence(handle(lookup(key)));
+}
+
+const vector<double>& config::getDoubleSequence(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, SEQUENCE);
+  const parsed_list<double>& seq = cachedSequence<double>(h.m_id, typed_cache::SEQ_DOUBLE,
+                                                           typed_cache::RANGE_DOUBLE);
+  if(!seq.valid) throwSyntax(h.m_id);
+  return seq.values;
+}
+
+const vector<int>& config::getIntList(std::string_view key) const {
+  return getIntList(handle(lookup(key)));
+}
+
+const vector<int>& config::getIntList(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, LIST);
+  const parsed_list<int>& list = cachedList<int>(h.m_id, typed_cache::LIST_INT);
+  if(!list.valid) throwSyntax(h.m_id);
+  return list.values;
+}
+
+const vector<double>& config::getDoubleList(std::string_view key) const {
+  return getDoubleList(handle(lookup(key)));
+}
+
+const vector<double>& config::getDoubleList(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, LIST);
+  const parsed_list<double>& list = cachedList<double>(h.m_id, typed_cache::LIST_DOUBLE);
+  if(!list.valid) throwSyntax(h.m_id);
+  return list.values;
+}
+
+const vector<string>& config::getStringList(std::string_view key) const {
+  return getStringList(handle(lookup(key)));
+}
+
+const vector<string>& config::getStringList(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, LIST);
+  const parsed_list<string>& list = cachedList<string>(h.m_id, typed_cache::LIST_STRING);
+  if(!list.valid) throwSyntax(h.m_id);
+  return list.values;
+}
+
+matrix_view<int> config::getIntMatrix(std::string_view key) const {
+  return getIntMatrix(handle(lookup(key)));
+}
+
+matrix_view<int> config::getIntMatrix(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, MATRIX);
+  const parsed_matrix<int>& m = cachedMatrix<int>(h.m_id, typed_cache::MATRIX_INT);
+  if(!m.valid) throwSyntax(h.m_id);
+  return matrix_view<int>(m.values.data(), m.shape.data(), m.shape.size());
+}
+
+matrix_view<double> config::getDoubleMatrix(std::string_view key) const {
+  return getDoubleMatrix(handle(lookup(key)));
+}
+
+matrix_view<double> config::getDoubleMatrix(handle h) const {
+  checkHandle(h);
+  CONFIG_COUNT_ACCESS(m_cache.stats(), h.m_id, MATRIX);
+  const parsed_matrix<double>& m = cachedMatrix<double>(h.m_id, typed_cache::MATRIX_DOUBLE);
+  if(!m.valid) throwSyntax(h.m_id);
+  return matrix_view<double>(m.values.data(), m.shape.data(), m.shape.size());
+}
+
+void config::addConfElem(std::string_view key, std::string_view val) {
+  // make sure key does not already exist
+  if(m_argMap.find(key) != arg_table::npos) throw invalidkey_exception(string(key));
+
+  setEntry(key, val, true, NO_SOURCE);
+  m_cache.grow(m_argMap.size());
+}
+
+bool config::keyExists(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return false;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, KEY_EXISTS);
+  return true;
+}
+
+size_t config::getParams(const binding* bindings, size_t nbBindings) const {
+  // look up every key before writing anything
+  vector<arg_table::id_type> ids(nbBindings);
+  size_t nbFound = 0;
+  for(size_t i=0; i<nbBindings; i++) {
+    ids[i] = m_argMap.find(bindings[i].m_key);
+    if(ids[i] != arg_table::npos) nbFound++;
+    else if(bindings[i].m_required) throw key_not_found(string(bindings[i].m_key));
+  }
+
+  for(size_t i=0; i<nbBindings; i++) {
+    const binding& b = bindings[i];
+    if(b.m_type == binding::OPTION) {
+      if(ids[i] != arg_table::npos) CONFIG_COUNT_ACCESS(m_cache.stats(), ids[i], CHECK_OPTION);
+      *static_cast<bool*>(b.m_dest) = (ids[i] != arg_table::npos);
+      continue;
+    }
+    if(ids[i] == arg_table::npos) continue;
+    handle h(ids[i]);
+    switch(b.m_type) {
+    case binding::UINT:   *static_cast<uint*>(b.m_dest) = parseParamUInt(h); break;
+    case binding::DOUBLE: *static_cast<double*>(b.m_dest) = parseParamDouble(h); break;
+    case binding::BOOL:   *static_cast<bool*>(b.m_dest) = parseParamBool(h); break;
+    case binding::STRING: *static_cast<string*>(b.m_dest) = getParamString(h); break;
+    case binding::VIEW:   *static_cast<std::string_view*>(b.m_dest) = getParamView(h); break;
+    case binding::UINT_RANGE:
+      *static_cast<seq_range<uint>*>(b.m_dest) = getUIntRange(h);
+      break;
+    case binding::DOUBLE_RANGE:
+      *static_cast<seq_range<double>*>(b.m_dest) = getDoubleRange(h);
+      break;
+    case binding::UINT_SEQUENCE:
+      *static_cast<vector<uint>*>(b.m_dest) = getUIntSequence(h);
+      break;
+    case binding::DOUBLE_SEQUENCE:
+      *static_cast<vector<double>*>(b.m_dest) = getDoubleSequence(h);
+      break;
+    case binding::INT_LIST:
+      *static_cast<vector<int>*>(b.m_dest) = getIntList(h);
+      break;
+    case binding::DOUBLE_LIST:
+      *static_cast<vector<double>*>(b.m_dest) = getDoubleList(h);
+      break;
+    case binding::STRING_LIST:
+      *static_cast<vector<string>*>(b.m_dest) = getStringList(h);
+      break;
+    case binding::OPTION:
+      break;
     }
-    return true;
-  } else {
-    return false;
   }
+  return nbFound;
 }
 
-bool config::listParser(string key, vector<double>& listReturn) const {
-  auto it = m_argMap.find(key);
-  if(it == m_argMap.end()) throw key_not_found(key);
+std::optional<config::handle> config::tryResolve(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return std::nullopt;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, RESOLVE);
+  return handle(id);
+}
 
-  listReturn.clear();
+std::optional<uint> config::tryParamUInt(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return std::nullopt;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, PARSE_UINT);
+  return cachedUInt(id);
+}
 
-  // check for, and then remove, the curly brackets
-  regex r("\\{(.+)\\}");
-  smatch regexMatch;
-  if(regex_search(it->second, regexMatch, r)) {
-    vector<string> tokens;
-    // the first element in regexMatch is the whole expression, while
-    // regexMatch[1] contains the expression within parentheses.
-    tokens = split(regexMatch[1], ',', tokens);
-    for(int i=0; i<tokens.size(); i++) {
-      listReturn.push_back(atof(tokens[i].c_str()));
-    }
-    return true;
-  } else {
-    return false;
+std::optional<double> config::tryParamDouble(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return std::nullopt;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, PARSE_DOUBLE);
+  return cachedDouble(id);
+}
+
+std::optional<bool> config::tryParamBool(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return std::nullopt;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, PARSE_BOOL);
+  return cachedBool(id);
+}
+
+std::optional<std::string_view> config::tryParamView(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return std::nullopt;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, GET_VIEW);
+  return m_argMap.value(id);
+}
+
+std::optional<seq_range<uint>> config::tryUIntRange(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return std::nullopt;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, RANGE);
+  const parsed_range<uint>& range = cachedRange<uint>(id, typed_cache::RANGE_UINT);
+  if(!range.valid) return std::nullopt;
+  return range.range;
+}
+
+std::optional<seq_range<double>> config::tryDoubleRange(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return std::nullopt;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, RANGE);
+  const parsed_range<double>& range = cachedRange<double>(id, typed_cache::RANGE_DOUBLE);
+  if(!range.valid) return std::nullopt;
+  return range.range;
+}
+
+const vector<uint>* config::tryUIntSequence(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return nullptr;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, SEQUENCE);
+  const parsed_list<uint>& seq = cachedSequence<uint>(id, typed_cache::SEQ_UINT,
+                                                       typed_cache::RANGE_UINT);
+  return seq.valid ? &seq.values : nullptr;
+}
+
+const vector<double>* config::tryDoubleSequence(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return nullptr;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, SEQUENCE);
+  const parsed_list<double>& seq = cachedSequence<double>(id, typed_cache::SEQ_DOUBLE,
+                                                           typed_cache::RANGE_DOUBLE);
+  return seq.valid ? &seq.values : nullptr;
+}
+
+const vector<int>* config::tryIntList(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return nullptr;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, LIST);
+  const parsed_list<int>& list = cachedList<int>(id, typed_cache::LIST_INT);
+  return list.valid ? &list.values : nullptr;
+}
+
+const vector<double>* config::tryDoubleList(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return nullptr;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, LIST);
+  const parsed_list<double>& list = cachedList<double>(id, typed_cache::LIST_DOUBLE);
+  return list.valid ? &list.values : nullptr;
+}
+
+const vector<string>* config::tryStringList(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) return nullptr;
+  CONFIG_COUNT_ACCESS(m_cache.stats(), id, LIST);
+  const parsed_list<string>& list = cachedList<string>(id, typed_cache::LIST_STRING);
+  return list.valid ? &list.values : nullptr;
+}
+
+uint config::getOr(std::string_view key, uint def) const {
+  return tryParamUInt(key).value_or(def);
+}
+
+int config::getOr(std::string_view key, int def) const {
+  std::optional<uint> v = tryParamUInt(key);
+  return v ? static_cast<int>(*v) : def;
+}
+
+double config::getOr(std::string_view key, double def) const {
+  return tryParamDouble(key).value_or(def);
+}
+
+bool config::getOr(std::string_view key, bool def) const {
+  return tryParamBool(key).value_or(def);
+}
+
+std::string_view config::getOr(std::string_view key, std::string_view def) const {
+  return tryParamView(key).value_or(def);
+}
+
+seq_range<uint> config::getOr(std::string_view key, const seq_range<uint>& def) const {
+  return tryUIntRange(key).value_or(def);
+}
+
+seq_range<double> config::getOr(std::string_view key, const seq_range<double>& def) const {
+  return tryDoubleRange(key).value_or(def);
+}
+
+const vector<int>& config::getOr(std::string_view key, const vector<int>& def) const {
+  const vector<int>* list = tryIntList(key);
+  return list ? *list : def;
+}
+
+const vector<double>& config::getOr(std::string_view key, const vector<double>& def) const {
+  const vector<double>* list = tryDoubleList(key);
+  return list ? *list : def;
+}
+
+const vector<string>& config::getOr(std::string_view key, const vector<string>& def) const {
+  const vector<string>* list = tryStringList(key);
+  return list ? *list : def;
+}
+
+#ifdef CONFIG_INSTRUMENTATION
+namespace {
+  /// Configurations whose access report is written at exit, and the file.
+  struct report_registry {
+    std::mutex mutex;
+    std::map<const config*, string> files;
+    /// Files already truncated by this process.
+    std::set<string> truncated;
+  };
+
+  report_registry& reportRegistry() {
+    // never destroyed, since configurations may be destroyed after it
+    static report_registry* registry = new report_registry();
+    return *registry;
+  }
+
+  void writeReportFile(const config& conf, const string& filepath,
+                       std::set<string>& truncated) {
+    std::ios::openmode mode = std::ios::app;
+    if(truncated.insert(filepath).second) mode = std::ios::trunc;
+    std::ofstream ofs(filepath.c_str(), std::ios::out | mode);
+    conf.writeAccessReport(ofs);
+  }
+
+  void dumpReportsAtExit() {
+    report_registry& registry = reportRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for(auto it = registry.files.begin(); it != registry.files.end(); ++it)
+      writeReportFile(*it->first, it->second, registry.truncated);
+    registry.files.clear();
+  }
+
+  bool moreLookups(const config::key_access& a, const config::key_access& b) {
+    if(a.totalLookups != b.totalLookups) return a.totalLookups > b.totalLookups;
+    return a.key < b.key;
   }
 }
 
-bool config::listParser(string key, vector<string>& listReturn) const {
-  auto it = m_argMap.find(key);
-  if(it == m_argMap.end()) throw key_not_found(key);
+config::~config() {
+  report_registry& registry = reportRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = registry.files.find(this);
+  if(it == registry.files.end()) return;
+  writeReportFile(*this, it->second, registry.truncated);
+  registry.files.erase(it);
+}
 
-  listReturn.clear();
+vector<config::key_access> config::accessReport() const {
+  vector<key_access> report(m_argMap.size());
+  for(arg_table::id_type id=0; id<m_argMap.size(); id++) {
+    report[id].key = string(m_argMap.key(id));
+    m_cache.stats().read(id, report[id]);
+  }
+  return report;
+}
 
-  // check for, and then remove, the curly brackets
-  regex r("\\{(.+)\\}");
-  smatch regexMatch;
-  if(regex_search(it->second, regexMatch, r)) {
-    // the first element in regexMatch is the whole expression, while
-    // regexMatch[1] contains the expression within parentheses.
-    listReturn = split(regexMatch[1], ',', listReturn);
-    return true;
-  } else {
-    return false;
+vector<string> config::unusedKeys() const {
+  vector<key_access> report = accessReport();
+  vector<string> unused;
+  for(size_t i=0; i<report.size(); i++) {
+    if(report[i].totalLookups == 0) unused.push_back(report[i].key);
   }
+  return unused;
 }
 
-void config::addConfElem(string key, string val) {
-  // make sure key does not already exist
-  auto it = m_argMap.find(key);
-  if(it != m_argMap.end()) throw invalidkey_exception(key);
+vector<config::key_access> config::hotKeys(size_t n) const {
+  vector<key_access> report = accessReport();
+  n = std::min(n, report.size());
+  std::partial_sort(report.begin(), report.begin() + n, report.end(), moreLookups);
+  report.resize(n);
+  return report;
+}
 
-  m_argMap[ key ] = val;
+void config::writeAccessReport(std::ostream& os) const {
+  vector<key_access> report = accessReport();
+  std::stable_sort(report.begin(), report.end(), moreLookups);
+  size_t nbUnused = 0;
+  for(size_t i=0; i<report.size(); i++) nbUnused += (report[i].totalLookups == 0);
+  os << "# key access report: " << (m_filePath.empty() ? "(no file)" : m_filePath)
+     << ", " << report.size() << " keys, " << nbUnused << " unused\n";
+  os << "key,lookups,parse_ns,parses";
+  for(int g=0; g<access_stats::NB_GETTERS; g++)
+    os << "," << access_stats::getterName(access_stats::getter(g));
+  os << "\n";
+  for(size_t i=0; i<report.size(); i++) {
+    const key_access& a = report[i];
+    os << a.key << "," << a.totalLookups << "," << a.parseNs << "," << a.nbParses;
+    for(int g=0; g<access_stats::NB_GETTERS; g++) os << "," << a.lookups[g];
+    os << "\n";
+  }
 }
 
-bool config::keyExists(string key) const {
-	auto it = m_argMap.find(key);
-	return it != m_argMap.end();
+void config::dumpAccessReportAtExit(string filepath) const {
+  static std::once_flag registered;
+  report_registry& registry = reportRegistry();
+  std::call_once(registered, []() { std::atexit(dumpReportsAtExit); });
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.files[this] = filepath;
 }
+#endif
 
 // Private
 
-void config::getline_nc(ifstream& ifs, string& line) {
-  char firstchar = COMMENTCHAR;
+void config::setArgument(const char* begin, const char* end,
+                         const string& filepath, size_t lineNumber, uint32_t source) {
+  line_scanner::range key, val;
+  if(line_scanner::scanKeyVal(begin, end, key, val)) {
+    std::string_view keyStr(key.begin, key.size());
+    if(m_checkKeys && (m_validKeys.find(keyStr) == arg_table::npos))
+      throw invalidkey_exception(string(keyStr), filepath, lineNumber);
+    setEntry(keyStr, std::string_view(val.begin, val.size()), true, source);
+  }
+  else if(line_scanner::scanOption(begin, end, key)) {
+    std::string_view option(key.begin, key.size());
+    if(m_checkKeys && (m_validOptions.find(option) == arg_table::npos))
+      throw invalidkey_exception(string(option), filepath, lineNumber);
+    setEntry(option, "", true, source);
+  }
+  else {
+    throw syntax_exception(string(begin, end), filepath, lineNumber);
+  }
+}
+
+void config::initResponseFile(const string& responsePath, const string& filepath,
+                              size_t lineNumber, vector<string>& responseStack) {
+  string resolved = filepath.empty() ? responsePath : resolveInclude(responsePath, filepath);
+  string canonical = canonicalPath(resolved);
+  checkIncludeCycle(canonical, responseStack, filepath, lineNumber);
+  int fd = open(canonical.c_str(), O_RDONLY);
+  if(fd < 0) throw file_exception(resolved, filepath, lineNumber);
+  fd_closer closer(fd);
+  uint32_t source = addSourceFile(canonical);
+  responseStack.push_back(canonical);
+  forEachLine(fd, resolved, STREAM_CHUNK_SIZE,
+              [&](const char* begin, const char* end, size_t argLine) {
+      if(*begin == RESPONSE_FILE_CHAR && end - begin > 1) {
+        initResponseFile(string(begin+1, end), resolved, argLine, responseStack);
+      } else {
+        setArgument(begin, end, resolved, argLine, source);
+      }
+    });
+  responseStack.pop_back();
+}
+
+uint32_t config::addSourceFile(const string& filepath) {
+  vector<string>::const_iterator it =
+    std::find(m_sourceFiles.begin(), m_sourceFiles.end(), filepath);
+  if(it != m_sourceFiles.end()) return it - m_sourceFiles.begin();
+  m_sourceFiles.push_back(filepath);
+  return m_sourceFiles.size() - 1;
+}
+
+void config::setEntry(std::string_view key, std::string_view val,
+                      bool overwrite, uint32_t source) {
+  size_t nbEntries = m_argMap.size();
+  arg_table::id_type id = m_argMap.set(key, val, overwrite);
+  // a value that is kept keeps its source
+  if(id < nbEntries && !overwrite) return;
+  if(m_entrySources.size() <= id) m_entrySources.resize(id + 1, NO_SOURCE);
+  m_entrySources[id] = source;
+  // a new value is expanded by interpolate(), even if it is equal to
+  // an escaped literal stored before
+  m_literalRefs.erase(id);
+}
+
+const string& config::sourcePathOf(arg_table::id_type id) const {
+  if(id < m_entrySources.size() && m_entrySources[id] != NO_SOURCE)
+    return m_sourceFiles[m_entrySources[id]];
+  return m_filePath;
+}
+
+arg_table::id_type config::lookup(std::string_view key) const {
+  arg_table::id_type id = m_argMap.find(key);
+  if(id == arg_table::npos) throw key_not_found(string(key));
+  return id;
+}
+
+uint config::cachedUInt(arg_table::id_type id) const {
+  return m_cache.get<uint>(id, typed_cache::UINT, [&](uint& v) {
+      CONFIG_TIME_PARSE(m_cache.stats(), id);
+      if(snapshotHas(id, typed_cache::UINT)) v = m_snapshot->view.record(id).uintVal;
+      else v = atoi(m_argMap.value(id).data());
+    });
+}
+
+double config::cachedDouble(arg_table::id_type id) const {
+  return m_cache.get<double>(id, typed_cache::DOUBLE, [&](double& v) {
+      CONFIG_TIME_PARSE(m_cache.stats(), id);
+      if(snapshotHas(id, typed_cache::DOUBLE)) v = m_snapshot->view.record(id).doubleVal;
+      else v = atof(m_argMap.value(id).data());
+    });
+}
+
+bool config::cachedBool(arg_table::id_type id) const {
+  return m_cache.get<bool>(id, typed_cache::BOOL, [&](bool& v) {
+      CONFIG_TIME_PARSE(m_cache.stats(), id);
+      if(snapshotHas(id, typed_cache::BOOL)) {
+        v = m_snapshot->view.record(id).boolVal != 0;
+        return;
+      }
+      std::string_view val = m_argMap.value(id);
+      v = (val == "1" || val == "true");
+    });
+}
+
+void config::throwSyntax(arg_table::id_type id) const {
+  string val(m_argMap.value(id));
+  throw syntax_exception(val);
+}
+
+line_scanner::range config::listContent(arg_table::id_type id) const {
+  std::string_view val = m_argMap.value(id);
+  line_scanner::range content;
+  if(!list_scanner::findContent(val.data(), val.data()+val.size(), content))
+    throwSyntax(id);
+  return content;
+}
+
+const array_file& config::cachedArray(arg_table::id_type id) const {
+  std::string_view val = m_argMap.value(id);
+  if(!array_file::isReference(val)) throwSyntax(id);
+  typedef std::shared_ptr<const array_file> array_ptr;
+  return *m_cache.get<array_ptr>(id, typed_cache::ARRAY, [&](array_ptr& array) {
+      CONFIG_TIME_PARSE(m_cache.stats(), id);
+      array = std::make_shared<array_file>(array_file::resolvePath(val, sourcePathOf(id)));
+    });
+}
+
+template<class T>
+array_view<T> config::typedArray(arg_table::id_type id, array_file::elem_type t) const {
+  const array_file& array = cachedArray(id);
+  if(array.type() != t) throwSyntax(id);
+  return array_view<T>(array.data<T>(), array.size());
+}
+
+bool config::snapshotHas(arg_table::id_type id, typed_cache::kind k) const {
+  // entries added by addConfElem() after loading are not in the snapshot
+  return m_snapshot && id < m_snapshot->view.size() &&
+    (m_snapshot->view.record(id).present & (1u << k));
+}
+
+void config::buildImage(image_builder& builder) const {
+  for(arg_table::id_type id=0; id<m_argMap.size(); id++) {
+    builder.setScalars(id, cachedUInt(id), cachedDouble(id), cachedBool(id));
+    if(id < m_entrySources.size() && m_entrySources[id] != NO_SOURCE)
+      builder.setSource(id, m_entrySources[id]);
+    // only the values of each kind are stored: a kind that is not
+    // stored is invalid (and cheap to parse again)
+    const parsed_range<uint>& uintRange = cachedRange<uint>(id, typed_cache::RANGE_UINT);
+    if(uintRange.valid) builder.setRange(id, uintRange);
+    const parsed_range<double>& doubleRange = cachedRange<double>(id, typed_cache::RANGE_DOUBLE);
+    if(doubleRange.valid) builder.setRange(id, doubleRange);
 
-  while(firstchar == COMMENTCHAR) {
-    if(!ifs.eof()) std::getline(ifs, line);
-    else line = "";
-    stringstream sstream;
-    sstream << line;
-    sstream >> std::ws; // extract whitespace
-    firstchar = sstream.peek();
+    // array references are kept as references, and only mapped when
+    // they are read
+    std::string_view val = m_argMap.value(id);
+    line_scanner::range content;
+    if(array_file::isReference(val) ||
+       !list_scanner::findContent(val.data(), val.data()+val.size(), content))
+      continue;
+    const parsed_list<int>& intList = cachedList<int>(id, typed_cache::LIST_INT);
+    if(intList.valid) builder.setList(id, typed_cache::LIST_INT, intList);
+    const parsed_list<double>& doubleList = cachedList<double>(id, typed_cache::LIST_DOUBLE);
+    if(doubleList.valid) builder.setList(id, typed_cache::LIST_DOUBLE, doubleList);
+    const parsed_list<string>& stringList = cachedList<string>(id, typed_cache::LIST_STRING);
+    if(stringList.valid) builder.setList(id, typed_cache::LIST_STRING, stringList);
   }
-  // trim leading and trailing whitespace
-  line = trim(line);
 }
 
-vector<string>& config::split(const string& s, char delim,
-                              vector<string>& elems) const {
-  // http://stackoverflow.com/questions/236129/how-to-split-a-string-in-c
-  stringstream ss(s);
-  string item;
-  ss >> std::ws; // extract leading whitespace
-  while (std::getline(ss, item, delim)) {
-    elems.push_back(item);
-    ss >> std::ws; // extract leading whitespace of next element
+template<class T>
+const parsed_range<T>& config::cachedRange(arg_table::id_type id,
+                                          typed_cache::kind k) const {
+  return m_cache.get< parsed_range<T> >(id, k, [&](parsed_range<T>& range) {
+      CONFIG_TIME_PARSE(m_cache.stats(), id);
+      if(snapshotHas(id, k)) m_snapshot->view.getRange(id, range);
+      else range.valid = parseSequence(m_argMap.value(id), range.range);
+    });
+}
+
+template<class T>
+const parsed_list<T>& config::cachedSequence(arg_table::id_type id, typed_cache::kind k,
+                                             typed_cache::kind rangeKind) const {
+  const parsed_range<T>& range = cachedRange<T>(id, rangeKind);
+  return m_cache.get< parsed_list<T> >(id, k, [&](parsed_list<T>& seq) {
+      CONFIG_TIME_PARSE(m_cache.stats(), id);
+      seq.valid = range.valid;
+      seq.values = range.range.vector();
+    });
+}
+
+template<class T>
+const parsed_matrix<T>& config::cachedMatrix(arg_table::id_type id,
+                                             typed_cache::kind k) const {
+  return m_cache.get< parsed_matrix<T> >(id, k, [&](parsed_matrix<T>& m) {
+      CONFIG_TIME_PARSE(m_cache.stats(), id);
+      std::string_view val = m_argMap.value(id);
+      m.valid = list_scanner::parseNested(val.data(), val.data()+val.size(),
+                                          m.values, m.shape);
+    });
+}
+
+template<class T>
+const parsed_list<T>& config::cachedList(arg_table::id_type id,
+                                         typed_cache::kind k) const {
+  return m_cache.get< parsed_list<T> >(id, k, [&](parsed_list<T>& list) {
+      CONFIG_TIME_PARSE(m_cache.stats(), id);
+      if(snapshotHas(id, k)) {
+        m_snapshot->view.getList(id, k, list);
+        return;
+      }
+      std::string_view val = m_argMap.value(id);
+      if(array_file::isReference(val)) {
+        // the elements are converted: the file does not need to remain mapped
+        array_file array(array_file::resolvePath(val, sourcePathOf(id)));
+        copyArray(array, list.values);
+        list.valid = true;
+        return;
+      }
+      list.valid = parseList(val, list.values);
+      if(!list.valid) list.values.clear();
+    });
+}
+
+bool config::parseSequence(std::string_view val, seq_range<uint>& range) {
+  range = seq_range<uint>();
+  const char* end = val.data() + val.size();
+
+  // find the first "<start>:<incr>:<end>" in the value
+  const char* fields[3];
+  const char* fieldEnds[3];
+  int nbFields = 0;
+  for(const char* p = val.data(); p < end && nbFields < 3; ) {
+    size_t n = digitRun(p, end);
+    if(n == 0) {
+      p++;
+      continue;
+    }
+    nbFields = 0;
+    for(const char* q = p; ; q++) {
+      size_t len = digitRun(q, end);
+      if(len == 0) break;
+      fields[nbFields] = q;
+      fieldEnds[nbFields] = q + len;
+      q += len;
+      if(++nbFields == 3 || q == end || *q != ':') break;
+    }
+    // a match cannot start within this run of digits either
+    p += n;
   }
-  return elems;
+  if(nbFields < 3) return false; // invalid syntax
+
+  uint64_t values[3];
+  for(int i=0; i<3; i++) {
+    std::from_chars_result r = std::from_chars(fields[i], fieldEnds[i], values[i]);
+    if(r.ec != std::errc() || values[i] > UINT_MAX) return false;
+  }
+  uint64_t start = values[0], incr = values[1], last = values[2];
+
+  if(incr == 0) {
+    range = seq_range<uint>(seq_range<uint>::LINEAR, start, 0, 1);
+    return true;
+  }
+  if(last < start) return false;
+  range = seq_range<uint>(seq_range<uint>::LINEAR, start, incr, (last - start) / incr + 1);
+  return true;
+}
+
+bool config::parseSequence(std::string_view val, seq_range<double>& range) {
+  range = seq_range<double>();
+  const char* begin = val.data();
+  const char* end = begin + val.size();
+
+  // exponential sequence syntax: <start>*<multiplier>:<end>
+  // linear sequence syntax:      <start>:<incr>:<end>
+  const char* startEnd = scanDecimal(begin, end);
+  if(!startEnd || startEnd == end || (*startEnd != '*' && *startEnd != ':')) return false;
+  bool geometric = *startEnd == '*';
+  const char* stepEnd = scanDecimal(startEnd+1, end);
+  if(!stepEnd || stepEnd == end || *stepEnd != ':') return false;
+  const char* lastEnd = scanDecimal(stepEnd+1, end);
+  if(lastEnd != end) return false;
+
+  double start, step, last;
+  std::from_chars(begin, startEnd, start);
+  std::from_chars(startEnd+1, stepEnd, step);
+  std::from_chars(stepEnd+1, lastEnd, last);
+
+  if(geometric) {
+    if(step <= 0) return false;
+    if(start > last) {
+      range = seq_range<double>(seq_range<double>::GEOMETRIC, start, step, 0);
+      return true;
+    }
+    // the sequence would never exceed its end value
+    if(start == 0 || step <= 1) return false;
+    double steps = std::log(last / start) / std::log(step);
+    if(!(steps < SEQ_MAX_STEPS)) return false;
+    size_t size = size_t(std::floor(steps + SEQ_END_TOLERANCE)) + 1;
+    range = seq_range<double>(seq_range<double>::GEOMETRIC, start, step, size);
+    return true;
+  }
+
+  if(step == 0) {
+    range = seq_range<double>(seq_range<double>::LINEAR, start, 0, 1);
+    return true;
+  }
+  if(last < start) return false;
+  double steps = (last - start) / step;
+  if(!(steps < SEQ_MAX_STEPS)) return false;
+  size_t size = size_t(std::floor(steps + SEQ_END_TOLERANCE)) + 1;
+  range = seq_range<double>(seq_range<double>::LINEAR, start, step, size);
+  return true;
 }
 
-// http://stackoverflow.com/questions/25829143/c-trim-whitespace-from-a-string
-std::string& config::trim(std::string & str) const
-{
-   return ltrim(rtrim(str));
+bool config::parseList(std::string_view val, vector<int>& listReturn) const {
+  listReturn.clear();
+  line_scanner::range content;
+  if(!list_scanner::findContent(val.data(), val.data()+val.size(), content)) return false;
+  // count the elements first, so that the vector is sized once
+  listReturn.resize(list_scanner::count(content.begin, content.end));
+  list_scanner::parse(content.begin, content.end, listReturn.data(), listReturn.size());
+  return true;
 }
 
-std::string& config::ltrim(std::string & str) const
-{
-  auto it2 =  std::find_if( str.begin() , str.end() , [](char ch){ return !std::isspace<char>(ch , std::locale::classic() ) ; } );
-  str.erase( str.begin() , it2);
-  return str;   
+bool config::parseList(std::string_view val, vector<double>& listReturn) const {
+  listReturn.clear();
+  line_scanner::range content;
+  if(!list_scanner::findContent(val.data(), val.data()+val.size(), content)) return false;
+  listReturn.resize(list_scanner::count(content.begin, content.end));
+  list_scanner::parse(content.begin, content.end, listReturn.data(), listReturn.size());
+  return true;
 }
 
-std::string& config::rtrim(std::string & str) const
-{
-  auto it1 =  std::find_if( str.rbegin() , str.rend() , [](char ch){ return !std::isspace<char>(ch , std::locale::classic() ) ; } );
-  str.erase( str.begin() + (  str.rend() - it1 ) , str.end() );
-  return str;   
+bool config::parseList(std::string_view val, vector<string>& listReturn) const {
+  listReturn.clear();
+  line_scanner::range content;
+  if(!list_scanner::findContent(val.data(), val.data()+val.size(), content)) return false;
+  listReturn.reserve(list_scanner::count(content.begin, content.end));
+  list_scanner::forEach(content.begin, content.end, [&](const char* begin, const char* end) {
+      listReturn.emplace_back(begin, end);
+    });
+  return true;
 }
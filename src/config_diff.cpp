@@ -0,0 +1,65 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/config_diff.hpp"
+
+#include <algorithm>
+
+using std::string;
+using std::vector;
+
+namespace {
+  /// Range of the (sorted) keys of "keys" that start with "prefix".
+  std::pair<vector<string>::const_iterator, vector<string>::const_iterator>
+  prefixRange(const vector<string>& keys, std::string_view prefix) {
+    vector<string>::const_iterator begin =
+      std::lower_bound(keys.begin(), keys.end(), prefix,
+                       [](const string& key, std::string_view p) { return key < p; });
+    vector<string>::const_iterator end = begin;
+    while(end != keys.end() && end->compare(0, prefix.size(), prefix) == 0) ++end;
+    return std::make_pair(begin, end);
+  }
+
+  bool hasPrefix(const vector<string>& keys, std::string_view prefix) {
+    std::pair<vector<string>::const_iterator, vector<string>::const_iterator> r =
+      prefixRange(keys, prefix);
+    return r.first != r.second;
+  }
+
+  void copyPrefix(const vector<string>& keys, std::string_view prefix, vector<string>& out) {
+    std::pair<vector<string>::const_iterator, vector<string>::const_iterator> r =
+      prefixRange(keys, prefix);
+    out.assign(r.first, r.second);
+  }
+}
+
+config_diff::config_diff(const config& before, const config& after) {
+  const arg_table& oldTable = before.m_argMap;
+  const arg_table& newTable = after.m_argMap;
+  for(arg_table::id_type id=0; id<newTable.size(); id++) {
+    std::string_view key = newTable.key(id);
+    arg_table::id_type oldId = oldTable.find(key);
+    if(oldId == arg_table::npos) m_added.push_back(string(key));
+    else if(oldTable.value(oldId) != newTable.value(id)) m_changed.push_back(string(key));
+  }
+  for(arg_table::id_type id=0; id<oldTable.size(); id++) {
+    std::string_view key = oldTable.key(id);
+    if(newTable.find(key) == arg_table::npos) m_removed.push_back(string(key));
+  }
+  std::sort(m_added.begin(), m_added.end());
+  std::sort(m_removed.begin(), m_removed.end());
+  std::sort(m_changed.begin(), m_changed.end());
+}
+
+bool config_diff::affects(std::string_view prefix) const {
+  return hasPrefix(m_added, prefix) || hasPrefix(m_removed, prefix) ||
+    hasPrefix(m_changed, prefix);
+}
+
+config_diff config_diff::filter(std::string_view prefix) const {
+  config_diff d;
+  copyPrefix(m_added, prefix, d.m_added);
+  copyPrefix(m_removed, prefix, d.m_removed);
+  copyPrefix(m_changed, prefix, d.m_changed);
+  return d;
+}
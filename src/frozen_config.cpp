@@ -0,0 +1,321 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/frozen_config.hpp"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <atomic>
+#include <boost/filesystem.hpp>
+
+using std::string;
+using std::vector;
+
+namespace {
+  const size_t STRING_LIST = typed_cache::LIST_STRING - typed_cache::LIST_INT;
+
+  /// Name of a shared memory object, which must start with '/'.
+  string shmName(const string& name) {
+    if(!name.empty() && name[0] == '/') return name;
+    return "/" + name;
+  }
+}
+
+frozen_config::frozen_config(vector<char> image)
+  : m_image(std::move(image))
+{
+  // the image was built by config::freeze(), attaching only fails on a bug
+  init(m_image.data(), m_image.size(), "<frozen configuration>");
+}
+
+void frozen_config::publish(string name) const {
+  name = shmName(name);
+  const char* image = reinterpret_cast<const char*>(&m_view.header());
+  size_t size = m_view.header().totalSize;
+
+  // a new object replaces the old one, which stays alive for the
+  // processes that have it mapped
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if(fd < 0) throw file_exception(name);
+  if(ftruncate(fd, size) != 0) {
+    close(fd);
+    shm_unlink(name.c_str());
+    throw file_exception(name);
+  }
+  void* mapping = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    throw file_exception(name);
+  }
+
+  // the magic number is written last: until then, attach() rejects
+  // the object
+  char* dest = static_cast<char*>(mapping);
+  size_t magicSize = sizeof(image_header().magic);
+  memcpy(dest + magicSize, image + magicSize, size - magicSize);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(dest, image, magicSize);
+  munmap(mapping, size);
+}
+
+std::shared_ptr<const frozen_config> frozen_config::attach(string name) {
+  name = shmName(name);
+  std::shared_ptr<frozen_config> conf(new frozen_config());
+  if(!conf->m_mapping.mapShared(name)) throw file_exception(name);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  conf->init(conf->m_mapping.data(), conf->m_mapping.size(), name);
+  return conf;
+}
+
+bool frozen_config::unpublish(string name) {
+  return shm_unlink(shmName(name).c_str()) == 0;
+}
+
+config::handle frozen_config::resolve(std::string_view key) const {
+  return config::handle(lookup(key));
+}
+
+uint frozen_config::parseParamUInt(std::string_view key) const {
+  return m_view.record(lookup(key)).uintVal;
+}
+
+uint frozen_config::parseParamUInt(config::handle h) const {
+  checkHandle(h);
+  return m_view.record(h.m_id).uintVal;
+}
+
+double frozen_config::parseParamDouble(std::string_view key) const {
+  return m_view.record(lookup(key)).doubleVal;
+}
+
+double frozen_config::parseParamDouble(config::handle h) const {
+  checkHandle(h);
+  return m_view.record(h.m_id).doubleVal;
+}
+
+bool frozen_config::parseParamBool(std::string_view key) const {
+  return m_view.record(lookup(key)).boolVal != 0;
+}
+
+bool frozen_config::parseParamBool(config::handle h) const {
+  checkHandle(h);
+  return m_view.record(h.m_id).boolVal != 0;
+}
+
+string frozen_config::getParamString(std::string_view key) const {
+  return string(m_view.value(lookup(key)));
+}
+
+std::string_view frozen_config::getParamView(std::string_view key) const {
+  return m_view.value(lookup(key));
+}
+
+std::string_view frozen_config::getParamView(config::handle h) const {
+  checkHandle(h);
+  return m_view.value(h.m_id);
+}
+
+bool frozen_config::checkOption(std::string_view key) const {
+  return m_view.find(key) != arg_table::npos;
+}
+
+bool frozen_config::keyExists(std::string_view key) const {
+  return m_view.find(key) != arg_table::npos;
+}
+
+bool frozen_config::sequenceParser(std::string_view key, vector<uint>& seqReturn) const {
+  const typed_record& r = m_view.record(lookup(key));
+  seqReturn = r.uintRange.vector();
+  return (r.valid & (1u << typed_cache::RANGE_UINT)) != 0;
+}
+
+bool frozen_config::sequenceParser(std::string_view key, vector<double>& seqReturn) const {
+  const typed_record& r = m_view.record(lookup(key));
+  seqReturn = r.doubleRange.vector();
+  return (r.valid & (1u << typed_cache::RANGE_DOUBLE)) != 0;
+}
+
+bool frozen_config::listParser(std::string_view key, vector<int>& listReturn) const {
+  arg_table::id_type id = lookup(key);
+  if(array_file::isReference(m_view.value(id))) {
+    listReturn = referencedArray(id, &referenced_lists::ints,
+                                 &referenced_lists::intsConverted).vector();
+    return true;
+  }
+  parsed_list<int> list;
+  m_view.getList(id, typed_cache::LIST_INT, list);
+  listReturn.swap(list.values);
+  return list.valid;
+}
+
+bool frozen_config::listParser(std::string_view key, vector<double>& listReturn) const {
+  arg_table::id_type id = lookup(key);
+  if(array_file::isReference(m_view.value(id))) {
+    listReturn = referencedArray(id, &referenced_lists::doubles,
+                                 &referenced_lists::doublesConverted).vector();
+    return true;
+  }
+  parsed_list<double> list;
+  m_view.getList(id, typed_cache::LIST_DOUBLE, list);
+  listReturn.swap(list.values);
+  return list.valid;
+}
+
+bool frozen_config::listParser(std::string_view key, vector<string>& listReturn) const {
+  arg_table::id_type id = lookup(key);
+  if(array_file::isReference(m_view.value(id))) {
+    referencedStrings(id);
+    listReturn = referenced(id).strings;
+    return true;
+  }
+  parsed_list<string> list;
+  m_view.getList(id, typed_cache::LIST_STRING, list);
+  listReturn.swap(list.values);
+  return list.valid;
+}
+
+seq_range<uint> frozen_config::getUIntRange(std::string_view key) const {
+  return getUIntRange(config::handle(lookup(key)));
+}
+
+seq_range<uint> frozen_config::getUIntRange(config::handle h) const {
+  checkHandle(h);
+  const typed_record& r = m_view.record(h.m_id);
+  if(!(r.valid & (1u << typed_cache::RANGE_UINT)))
+    throw syntax_exception(string(m_view.value(h.m_id)));
+  return r.uintRange;
+}
+
+seq_range<double> frozen_config::getDoubleRange(std::string_view key) const {
+  return getDoubleRange(config::handle(lookup(key)));
+}
+
+seq_range<double> frozen_config::getDoubleRange(config::handle h) const {
+  checkHandle(h);
+  const typed_record& r = m_view.record(h.m_id);
+  if(!(r.valid & (1u << typed_cache::RANGE_DOUBLE)))
+    throw syntax_exception(string(m_view.value(h.m_id)));
+  return r.doubleRange;
+}
+
+array_view<int> frozen_config::getIntList(std::string_view key) const {
+  return getIntList(config::handle(lookup(key)));
+}
+
+array_view<int> frozen_config::getIntList(config::handle h) const {
+  checkHandle(h);
+  if(array_file::isReference(m_view.value(h.m_id)))
+    return referencedArray(h.m_id, &referenced_lists::ints, &referenced_lists::intsConverted);
+  return array<int>(h.m_id, typed_cache::LIST_INT);
+}
+
+array_view<double> frozen_config::getDoubleList(std::string_view key) const {
+  return getDoubleList(config::handle(lookup(key)));
+}
+
+array_view<double> frozen_config::getDoubleList(config::handle h) const {
+  checkHandle(h);
+  if(array_file::isReference(m_view.value(h.m_id)))
+    return referencedArray(h.m_id, &referenced_lists::doubles,
+                           &referenced_lists::doublesConverted);
+  return array<double>(h.m_id, typed_cache::LIST_DOUBLE);
+}
+
+array_view<std::string_view> frozen_config::getStringList(std::string_view key) const {
+  return getStringList(config::handle(lookup(key)));
+}
+
+array_view<std::string_view> frozen_config::getStringList(config::handle h) const {
+  checkHandle(h);
+  if(array_file::isReference(m_view.value(h.m_id))) return referencedStrings(h.m_id);
+  const typed_record& r = m_view.record(h.m_id);
+  if(!(r.valid & (1u << typed_cache::LIST_STRING)))
+    throw syntax_exception(string(m_view.value(h.m_id)));
+  std::call_once(m_stringsIndexed, [this]() { indexStrings(); });
+  return array_view<std::string_view>(m_strings.data() + m_stringListStart[h.m_id],
+                                      r.listLen[STRING_LIST]);
+}
+
+// Private
+
+void frozen_config::init(const char* data, size_t size, const string& name) {
+  if(!m_view.attach(data, size)) throw snapshot_exception(name);
+  m_filePath = string(m_view.sourcePath());
+  m_fileName = boost::filesystem::path(m_filePath).filename().string();
+}
+
+void frozen_config::indexStrings() const {
+  // index the elements of the string lists so that they can be
+  // returned as an array
+  m_stringListStart.resize(m_view.size());
+  for(arg_table::id_type id=0; id<m_view.size(); id++) {
+    const typed_record& r = m_view.record(id);
+    m_stringListStart[id] = m_strings.size();
+    const char* p = m_view.payload() + r.listOff[STRING_LIST];
+    for(uint64_t i=0; i<r.listLen[STRING_LIST]; i++) {
+      uint32_t len;
+      memcpy(&len, p, sizeof(len));
+      p += sizeof(len);
+      m_strings.push_back(std::string_view(p, len));
+      p += len;
+    }
+  }
+}
+
+arg_table::id_type frozen_config::lookup(std::string_view key) const {
+  arg_table::id_type id = m_view.find(key);
+  if(id == arg_table::npos) throw key_not_found(string(key));
+  return id;
+}
+
+frozen_config::referenced_lists& frozen_config::referenced(arg_table::id_type id) const {
+  std::lock_guard<std::mutex> lock(m_referencedMutex);
+  std::unique_ptr<referenced_lists>& lists = m_referenced[id];
+  if(!lists) lists.reset(new referenced_lists());
+  return *lists;
+}
+
+string frozen_config::sourcePathOf(arg_table::id_type id) const {
+  uint32_t source = m_view.record(id).source;
+  if(source == typed_record::NO_SOURCE) return m_filePath;
+  return string(m_view.stampPath(source));
+}
+
+template<class T>
+array_view<T> frozen_config::referencedArray(arg_table::id_type id,
+                                             vector<T> referenced_lists::* elems,
+                                             std::once_flag referenced_lists::* converted) const {
+  referenced_lists& lists = referenced(id);
+  // if the file cannot be mapped, the next call tries again
+  std::call_once(lists.*converted, [&]() {
+      array_file file(array_file::resolvePath(m_view.value(id), sourcePathOf(id)));
+      vector<T>& dest = lists.*elems;
+      dest.resize(file.size());
+      file.copyTo(dest.data(), dest.size());
+    });
+  const vector<T>& values = lists.*elems;
+  return array_view<T>(values.data(), values.size());
+}
+
+array_view<std::string_view> frozen_config::referencedStrings(arg_table::id_type id) const {
+  referenced_lists& lists = referenced(id);
+  std::call_once(lists.stringsConverted, [&]() {
+      array_file file(array_file::resolvePath(m_view.value(id), sourcePathOf(id)));
+      file.copyTo(lists.strings);
+      lists.views.assign(lists.strings.begin(), lists.strings.end());
+    });
+  return array_view<std::string_view>(lists.views.data(), lists.views.size());
+}
+
+template<class T>
+array_view<T> frozen_config::array(arg_table::id_type id, typed_cache::kind k) const {
+  if(!(m_view.record(id).valid & (1u << k)))
+    throw syntax_exception(string(m_view.value(id)));
+  size_t n;
+  const T* elems = m_view.array<T>(id, k, n);
+  return array_view<T>(elems, n);
+}
@@ -0,0 +1,271 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/reloader.hpp"
+
+#include <boost/filesystem.hpp>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using std::string;
+using boost::filesystem::path;
+
+namespace {
+  /// Events that signal a new version of the watched file.
+  const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+  /**
+   * Time (in milliseconds) without further events on the file before
+   * reloading it, so that a burst of writes causes a single reload.
+   */
+  const int SETTLE_DELAY_MS = 20;
+
+  /// Prefixes an error message with its location in a file, if known.
+  string withLocation(const string& location, const string& message) {
+    return location.empty() ? message : location + ": " + message;
+  }
+}
+
+// ---------- reader ----------
+
+config_reloader::reader::reader(const config_reloader& reloader)
+  : m_reloader(&reloader),
+    m_generation(0)
+{
+  refresh();
+}
+
+void config_reloader::reader::refresh() {
+  // read the generation first: if a version is published in between,
+  // the next call to get() refreshes again
+  m_generation = m_reloader->m_generation.load(std::memory_order_acquire);
+  m_config = m_reloader->current();
+}
+
+// ---------- config_reloader ----------
+
+config_reloader::config_reloader(string filepath, setup_function setup)
+  : m_filePath(filepath),
+    m_setup(setup),
+    m_generation(0),
+    m_notifying(false),
+    m_nextSubscription(1),
+    m_inotifyFd(-1),
+    m_stopFd(-1)
+{
+  publish(load());
+}
+
+config_reloader::~config_reloader() {
+  stop();
+}
+
+bool config_reloader::reload() {
+  {
+    std::lock_guard<std::mutex> lock(m_reloadMutex);
+    string error;
+    try {
+      std::shared_ptr<const config> previous = current();
+      std::shared_ptr<const config> next = load();
+      publish(next);
+      // queued under the reload lock, so that versions are notified in
+      // the order they are published
+      std::lock_guard<std::mutex> notifyLock(m_notifyMutex);
+      m_pending.push_back(std::make_pair(previous, next));
+    } catch(file_exception& e) {
+      error = withLocation(e.location(), string("cannot read file ") + e.what());
+    } catch(syntax_exception& e) {
+      error = withLocation(e.location(), string("invalid syntax: ") + e.what());
+    } catch(invalidkey_exception& e) {
+      error = withLocation(e.location(), string("invalid key: ") + e.what());
+    }
+    setLastError(error);
+    if(!error.empty()) return false;
+  }
+  notifyPending();
+  return true;
+}
+
+string config_reloader::lastError() const {
+  std::lock_guard<std::mutex> lock(m_errorMutex);
+  return m_lastError;
+}
+
+uint64_t config_reloader::subscribe(string prefix, change_callback callback) {
+  std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+  subscription sub;
+  sub.id = m_nextSubscription++;
+  sub.prefix = prefix;
+  sub.callback = callback;
+  m_subscriptions.push_back(sub);
+  return sub.id;
+}
+
+void config_reloader::unsubscribe(uint64_t id) {
+  std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+  for(size_t i=0; i<m_subscriptions.size(); i++) {
+    if(m_subscriptions[i].id == id) {
+      m_subscriptions.erase(m_subscriptions.begin() + i);
+      return;
+    }
+  }
+}
+
+void config_reloader::start() {
+  if(m_watcher.joinable()) return;
+
+  // Watch the directory rather than the file, since editors often
+  // replace the file by renaming a new one over it.
+  path dir = path(m_filePath).parent_path();
+  if(dir.empty()) dir = ".";
+  int inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  if(inotifyFd < 0) throw file_exception(m_filePath);
+  if(inotify_add_watch(inotifyFd, dir.string().c_str(), WATCH_MASK) < 0) {
+    close(inotifyFd);
+    throw file_exception(dir.string());
+  }
+  int stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if(stopFd < 0) {
+    close(inotifyFd);
+    throw file_exception(m_filePath);
+  }
+
+  m_inotifyFd = inotifyFd;
+  m_stopFd = stopFd;
+  m_watcher = std::thread(&config_reloader::watch, this, inotifyFd, stopFd);
+}
+
+void config_reloader::stop() {
+  if(!m_watcher.joinable()) return;
+  uint64_t one = 1;
+  while(write(m_stopFd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+  m_watcher.join();
+  close(m_inotifyFd);
+  close(m_stopFd);
+  m_inotifyFd = -1;
+  m_stopFd = -1;
+}
+
+// Private
+
+std::shared_ptr<const config> config_reloader::load() const {
+  std::shared_ptr<config> conf = std::make_shared<config>();
+  if(m_setup) m_setup(*conf);
+  conf->initFileMapped(m_filePath);
+  return conf;
+}
+
+void config_reloader::setLastError(const string& error) {
+  std::lock_guard<std::mutex> lock(m_errorMutex);
+  m_lastError = error;
+}
+
+void config_reloader::publish(std::shared_ptr<const config> conf) {
+  std::atomic_store(&m_current, conf);
+  m_generation.fetch_add(1, std::memory_order_release);
+}
+
+void config_reloader::notifyPending() {
+  // Only one thread delivers notifications at a time, in the order of
+  // the queue. Another thread (or a callback calling reload()) only
+  // queues its version, which the delivering thread then notifies
+  // after the current one.
+  {
+    std::lock_guard<std::mutex> lock(m_notifyMutex);
+    if(m_notifying) return;
+    m_notifying = true;
+  }
+  for(;;) {
+    std::pair<std::shared_ptr<const config>, std::shared_ptr<const config> > versions;
+    {
+      std::lock_guard<std::mutex> lock(m_notifyMutex);
+      if(m_pending.empty()) {
+        m_notifying = false;
+        return;
+      }
+      versions = m_pending.front();
+      m_pending.pop_front();
+    }
+    // the callbacks are called without any lock, so that they can
+    // call reload()
+    try {
+      notify(*versions.first, versions.second);
+    } catch(...) {
+      std::lock_guard<std::mutex> lock(m_notifyMutex);
+      m_notifying = false;
+      throw;
+    }
+  }
+}
+
+void config_reloader::notify(const config& previous,
+                             const std::shared_ptr<const config>& current) {
+  // callbacks are called without the lock, so that they can subscribe
+  std::vector<subscription> subscriptions;
+  {
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    if(m_subscriptions.empty()) return;
+    subscriptions = m_subscriptions;
+  }
+  config_diff diff(previous, *current);
+  if(diff.empty()) return;
+  for(size_t i=0; i<subscriptions.size(); i++) {
+    if(!diff.affects(subscriptions[i].prefix)) continue;
+    // a failing subscriber must not prevent the others from being notified
+    try {
+      subscriptions[i].callback(diff.filter(subscriptions[i].prefix), current);
+    } catch(std::exception& e) {
+      setLastError(string("subscriber failed: ") + e.what());
+    } catch(...) {
+      setLastError("subscriber failed");
+    }
+  }
+}
+
+void config_reloader::watch(int inotifyFd, int stopFd) {
+  const string fileName = path(m_filePath).filename().string();
+  alignas(struct inotify_event) char buffer[4096];
+  struct pollfd fds[2];
+  fds[0].fd = inotifyFd;
+  fds[0].events = POLLIN;
+  fds[1].fd = stopFd;
+  fds[1].events = POLLIN;
+
+  bool pending = false;
+  for(;;) {
+    // wait for an event, or for the file to settle if a reload is pending
+    int n = poll(fds, 2, pending ? SETTLE_DELAY_MS : -1);
+    if(n < 0) {
+      if(errno == EINTR) continue;
+      return;
+    }
+    if(fds[1].revents) return;
+    if(n == 0) {
+      pending = false;
+      // nothing may escape the thread (e.g. bad_alloc, or an exception
+      // from the setup function)
+      try {
+        reload();
+      } catch(std::exception& e) {
+        setLastError(string("reload failed: ") + e.what());
+      } catch(...) {
+        setLastError("reload failed");
+      }
+      continue;
+    }
+
+    ssize_t len;
+    while((len = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+      for(char* p = buffer; p < buffer + len; ) {
+        const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+        if(event->len > 0 && fileName == event->name) pending = true;
+        p += sizeof(struct inotify_event) + event->len;
+      }
+    }
+  }
+}
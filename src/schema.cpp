@@ -0,0 +1,147 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/schema.hpp"
+#include "config/private/ListScanner.hpp"
+
+#include <limits.h>
+#include <charconv>
+
+using std::string;
+using std::vector;
+
+namespace {
+  /// Removes the leading and trailing whitespace of a value.
+  std::string_view trimmed(std::string_view val) {
+    const char* begin = val.data();
+    const char* end = begin + val.size();
+    while(begin < end && line_scanner::isSpace(*begin)) begin++;
+    while(end > begin && line_scanner::isSpace(*(end-1))) end--;
+    return std::string_view(begin, end - begin);
+  }
+
+  /**
+   * Converts all of [begin, end) to a number. A leading '+' is
+   * accepted, as it is by atoi() and atof().
+   */
+  template<class T>
+  bool convert(const char* begin, const char* end, T& out) {
+    if(begin < end && *begin == '+') {
+      begin++;
+      if(begin < end && *begin == '-') return false;
+    }
+    if(begin == end) return false;
+    std::from_chars_result r = std::from_chars(begin, end, out);
+    return r.ec == std::errc() && r.ptr == end;
+  }
+
+  template<class T>
+  bool convert(std::string_view val, T& out) {
+    val = trimmed(val);
+    return convert(val.data(), val.data() + val.size(), out);
+  }
+
+  /// Converts each element of a list with convert().
+  template<class T>
+  bool parseNumberList(std::string_view val, vector<T>& out) {
+    out.clear();
+    line_scanner::range content;
+    if(!list_scanner::findContent(val.data(), val.data()+val.size(), content)) return false;
+    out.reserve(list_scanner::count(content.begin, content.end));
+    bool valid = true;
+    list_scanner::forEach(content.begin, content.end, [&](const char* begin, const char* end) {
+        T x;
+        if(valid && convert(std::string_view(begin, end - begin), x)) out.push_back(x);
+        else valid = false;
+      });
+    if(!valid) out.clear();
+    return valid;
+  }
+}
+
+bool schema_value::parse(std::string_view val, uint& out) {
+  val = trimmed(val);
+  if(!val.empty() && val[0] == '-') return false;
+  unsigned long x;
+  if(!convert(val.data(), val.data() + val.size(), x) || x > UINT_MAX) return false;
+  out = static_cast<uint>(x);
+  return true;
+}
+
+bool schema_value::parse(std::string_view val, int& out) {
+  return convert(val, out);
+}
+
+bool schema_value::parse(std::string_view val, double& out) {
+  return convert(val, out);
+}
+
+bool schema_value::parse(std::string_view val, bool& out) {
+  val = trimmed(val);
+  if(val == "1" || val == "true") out = true;
+  else if(val == "0" || val == "false") out = false;
+  else return false;
+  return true;
+}
+
+bool schema_value::parse(std::string_view val, string& out) {
+  out.assign(val.data(), val.size());
+  return true;
+}
+
+bool schema_value::parse(std::string_view val, vector<int>& out) {
+  return parseNumberList(val, out);
+}
+
+bool schema_value::parse(std::string_view val, vector<double>& out) {
+  return parseNumberList(val, out);
+}
+
+bool schema_value::parse(std::string_view val, vector<string>& out) {
+  // same elements as config::getStringList()
+  out.clear();
+  line_scanner::range content;
+  if(!list_scanner::findContent(val.data(), val.data()+val.size(), content)) return false;
+  out.reserve(list_scanner::count(content.begin, content.end));
+  list_scanner::forEach(content.begin, content.end, [&](const char* begin, const char* end) {
+      out.emplace_back(begin, end);
+    });
+  return true;
+}
+
+bool schema_value::parse(std::string_view val, seq_range<uint>& out) {
+  return parseSequence(val, out);
+}
+
+bool schema_value::parse(std::string_view val, seq_range<double>& out) {
+  return parseSequence(val, out);
+}
+
+bool schema_value::parseSequence(std::string_view val, seq_range<uint>& out) {
+  return config::parseSequence(val, out);
+}
+
+bool schema_value::parseSequence(std::string_view val, seq_range<double>& out) {
+  return config::parseSequence(val, out);
+}
+
+bool schema_value::parseSequence(std::string_view val, vector<uint>& out) {
+  seq_range<uint> range;
+  if(!config::parseSequence(val, range)) return false;
+  out = range.vector();
+  return true;
+}
+
+bool schema_value::parseSequence(std::string_view val, vector<double>& out) {
+  seq_range<double> range;
+  if(!config::parseSequence(val, range)) return false;
+  out = range.vector();
+  return true;
+}
+
+void schema_value::forEach(const config& conf,
+                           const std::function<void(std::string_view, std::string_view)>& f) {
+  for(arg_table::id_type id=0; id<conf.m_argMap.size(); id++) {
+    f(conf.m_argMap.key(id), conf.m_argMap.value(id));
+  }
+}
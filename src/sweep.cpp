@@ -0,0 +1,105 @@
+// Author: Francois Leduc-Primeau
+// Copyright 2013
+
+#include "config/sweep.hpp"
+
+#include <limits.h>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+using std::string;
+using std::vector;
+
+sweep::sweep(const config& conf, const vector<string>& keys)
+  : m_conf(conf),
+    m_axes(keys.size()),
+    m_size(1)
+{
+  for(size_t a=0; a<keys.size(); a++) {
+    axis& ax = m_axes[a];
+    ax.name = keys[a];
+    config::handle h = conf.resolve(keys[a]);
+    ax.strings = 0;
+    ax.ints = 0;
+    ax.doubles = 0;
+    if(conf.getParamView(h).find('{') != std::string_view::npos) {
+      ax.kind = LIST_AXIS;
+      ax.strings = &conf.getStringList(h);
+      ax.ints = &conf.getIntList(h);
+      ax.doubles = &conf.getDoubleList(h);
+      ax.size = ax.strings->size();
+    } else {
+      ax.kind = RANGE_AXIS;
+      ax.range = conf.getDoubleRange(h);
+      ax.size = ax.range.size();
+    }
+    if(ax.size != 0 && m_size > SIZE_MAX / ax.size)
+      throw std::overflow_error("sweep over " + keys[a] + " has too many points");
+    m_size *= ax.size;
+  }
+
+  size_t stride = 1;
+  for(size_t a=m_axes.size(); a-- > 0; ) {
+    m_axes[a].stride = stride;
+    stride *= m_axes[a].size;
+  }
+}
+
+seq_range<size_t> sweep::shard(size_t worker, size_t nbWorkers) const {
+  checkWorker(worker, nbWorkers);
+  return seq_range<size_t>(seq_range<size_t>::LINEAR, 0, 1, m_size).shard(worker, nbWorkers);
+}
+
+seq_range<size_t> sweep::stridedShard(size_t worker, size_t nbWorkers) const {
+  checkWorker(worker, nbWorkers);
+  // computed without overflow for any number of points
+  size_t count = worker < m_size ? (m_size - worker - 1) / nbWorkers + 1 : 0;
+  return seq_range<size_t>(seq_range<size_t>::LINEAR, worker, nbWorkers, count);
+}
+
+void sweep::checkWorker(size_t worker, size_t nbWorkers) {
+  if(nbWorkers == 0 || worker >= nbWorkers)
+    throw std::invalid_argument("sweep: invalid worker");
+}
+
+const sweep::axis* sweep::findAxis(std::string_view key) const {
+  // sweeps have few axes: a linear search is faster than hashing
+  for(size_t a=0; a<m_axes.size(); a++) {
+    if(m_axes[a].name == key) return &m_axes[a];
+  }
+  return 0;
+}
+
+// ---------- point ----------
+
+uint sweep::point::parseParamUInt(std::string_view key) const {
+  const axis* ax = m_sweep->findAxis(key);
+  if(!ax) return m_sweep->m_conf.parseParamUInt(key);
+  size_t i = (m_index / ax->stride) % ax->size;
+  // converting a negative or fractional value would be undefined
+  double value = ax->kind == LIST_AXIS ? (*ax->ints)[i] : ax->range[i];
+  if(!(value >= 0 && value <= UINT_MAX) || value != std::floor(value))
+    throw syntax_exception(getParamString(key));
+  return uint(value);
+}
+
+double sweep::point::parseParamDouble(std::string_view key) const {
+  const axis* ax = m_sweep->findAxis(key);
+  if(!ax) return m_sweep->m_conf.parseParamDouble(key);
+  size_t i = (m_index / ax->stride) % ax->size;
+  if(ax->kind == LIST_AXIS) return (*ax->doubles)[i];
+  return ax->range[i];
+}
+
+string sweep::point::getParamString(std::string_view key) const {
+  const axis* ax = m_sweep->findAxis(key);
+  if(!ax) return m_sweep->m_conf.getParamString(key);
+  size_t i = (m_index / ax->stride) % ax->size;
+  if(ax->kind == LIST_AXIS) return (*ax->strings)[i];
+  // shortest representation that reads back as the same number
+  char buffer[32];
+  std::to_chars_result r = std::to_chars(buffer, buffer + sizeof(buffer), ax->range[i]);
+  return string(buffer, r.ptr);
+}
@@ -1,11 +1,45 @@
 #include "config/config.hpp"
+#include "config/config_diff.hpp"
+#include "config/frozen_config.hpp"
+#include "config/reloader.hpp"
+#include "config/schema.hpp"
+#include "config/sweep.hpp"
 
 #include <string>
+#include <atomic>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using std::cerr;
 using std::endl;
 
+struct sample_params {
+  std::string name;
+  uint count;
+  double ratio;
+  int other;
+  std::vector<int> values;
+  bool verbose;
+};
+
+constexpr auto sampleSchema = make_schema<sample_params>(
+  schema_key("key_string", &sample_params::name),
+  schema_key("key_int", &sample_params::count),
+  schema_key("key_float", &sample_params::ratio),
+  schema_key("key2", &sample_params::other),
+  schema_key("mylist", &sample_params::values),
+  schema_key("verbose", &sample_params::verbose, "false"));
+
+static_assert(sampleSchema.find("key2") == 3 &&
+              sampleSchema.find("key3") == decltype(sampleSchema)::npos,
+              "schema keys are hashed at compile time");
+
 void setAuthorizedKeys(config& conf) {
 	conf.addValidKey("config");
 	conf.addValidKey("key_string");
@@ -33,10 +67,9 @@ int main(int argc, char** argv) {
 
   // if a configuration file is specified, load its content
   try {
-    std::string confpath = conf.getParamString("config");
-    conf.initFile(confpath);
-  } catch(key_not_found& e) {
-	  //cerr << "Warning: No configuration file specified, using command line arguments only." << endl;
+    if(std::optional<std::string_view> confpath = conf.tryParamView("config")) {
+      conf.initFile(std::string(*confpath));
+    }
   } catch(invalidkey_exception& e) {
     cerr << "Invalid key: "<<e.what()<<endl;
     return 1;
@@ -75,6 +108,652 @@ int main(int argc, char** argv) {
 	  return 1;
   }
 
+  // typed values are cached: repeated lookups return the same vector
+  const std::vector<int>& cachedList = conf.getIntList("mylist");
+  if(&cachedList != &conf.getIntList("mylist") || cachedList != mylist ||
+     conf.parseParamUInt("key_int") != 42) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // long lists can be parsed into a caller-provided buffer
+  int listBuffer[3];
+  if(conf.listSize("mylist") != 5 ||
+     conf.listParser("mylist", listBuffer, 3) != 5 || listBuffer[2] != 3) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // binary arrays referenced with "@file:" are mapped and used in place
+  std::string arrayPath = conf.getFilePath() + ".f64";
+  double weights[3] = {0.5, -2, 1e10};
+  FILE* arrayFile = fopen(arrayPath.c_str(), "wb");
+  fwrite(weights, sizeof(double), 3, arrayFile);
+  fclose(arrayFile);
+  config arrayConf;
+  setAuthorizedKeys(arrayConf);
+  arrayConf.initFileMapped(conf.getFilePath());
+  arrayConf.addConfElem("weights", "@file:" + conf.getFileName() + ".f64");
+  array_view<double> weightsView = arrayConf.getDoubleArray("weights");
+  std::vector<double> weightsList;
+  bool weightsParsed = arrayConf.listParser("weights", weightsList);
+  std::vector<int> weightsInt = arrayConf.getIntList("weights");
+  // references are frozen as such: a missing file is only an error when read
+  arrayConf.addConfElem("missing", "@file:missing.f64");
+  std::shared_ptr<const frozen_config> frozenArrays = arrayConf.freeze();
+  array_view<double> frozenWeights = frozenArrays->getDoubleList("weights");
+  bool missingReported = false;
+  try {
+    frozenArrays->getIntList("missing");
+  } catch(file_exception&) {
+    missingReported = true;
+  }
+  remove(arrayPath.c_str());
+  if(weightsView.size() != 3 || weightsView[1] != -2 || !weightsParsed ||
+     weightsList != weightsView.vector() || weightsInt[0] != 0 || weightsInt[1] != -2 ||
+     weightsInt[2] != INT_MAX || frozenWeights.vector() != weightsList ||
+     !missingReported) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // nested lists are parsed into contiguous row-major storage, and
+  // ragged lists are rejected
+  config matrixConf;
+  matrixConf.addConfElem("gains", "{{1, 2.5, -3}, { 4, 5, 6e1 }}");
+  matrixConf.addConfElem("cube", "{{{1,2},{3,4}},{{5,6},{7,8}}}");
+  matrixConf.addConfElem("ragged", "{{1, 2}, {3}}");
+  matrixConf.addConfElem("mixed", "{{1, 2}, 3}");
+  matrixConf.addConfElem("partial", "{{1, 2}, {3, 4x}}");
+  matrixConf.addConfElem("signs", "{{1, 2}, {3, +-4}}");
+  matrixConf.addConfElem("deep", std::string(100000, '{') + "1" + std::string(100000, '}'));
+  matrix_view<double> gains = matrixConf.getDoubleMatrix("gains");
+  matrix_view<int> cube = matrixConf.getIntMatrix(matrixConf.resolve("cube"));
+  int nbRejected = 0;
+  const char* invalidKeys[] = {"ragged", "mixed", "partial", "signs", "deep"};
+  for(const char* k : invalidKeys) {
+    try {
+      matrixConf.getDoubleMatrix(k);
+    } catch(syntax_exception&) {
+      nbRejected++;
+    }
+  }
+  if(gains.rank() != 2 || gains.rows() != 2 || gains.cols() != 3 ||
+     gains(0,1) != 2.5 || gains(1,2) != 60 || gains.data()[3] != 4 ||
+     gains.data() != matrixConf.getDoubleMatrix("gains").data() ||
+     cube.rank() != 3 || cube.size() != 8 || cube.dim(2) != 2 ||
+     cube.data()[5] != 6 || nbRejected != 5) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // getters taking a handle return the same values as the named getters,
+  // and reject a default handle
+  config::handle intHandle = conf.resolve("key_int");
+  config::handle defaultHandle;
+  bool defaultRejected = false;
+  try {
+    conf.getParamView(defaultHandle);
+  } catch(key_not_found&) {
+    defaultRejected = true;
+  }
+  if(conf.parseParamUInt(intHandle) != 42 || !intHandle.valid() ||
+     defaultHandle.valid() || !defaultRejected ||
+     conf.getIntList(conf.resolve("mylist")) != mylist) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // repeated overrides reuse or reclaim the space of replaced values
+  arg_table overridden;
+  overridden.set("other", "kept");
+  for(int i=0; i<10000; i++) {
+    overridden.set("layered", std::string(i % 100 + 1, 'a' + i % 26));
+  }
+  // lengths that do not fit in an entry are rejected, not truncated
+  // (the view is never read)
+  bool hugeRejected = sizeof(size_t) <= 4;
+  try {
+    if(!hugeRejected) overridden.set("huge", std::string_view("x", size_t(UINT32_MAX) + 1));
+  } catch(std::length_error&) {
+    hugeRejected = true;
+  }
+  if(overridden.arenaSize() > 20000 || !hugeRejected || overridden.find("huge") != arg_table::npos ||
+     overridden.value(overridden.find("other")) != "kept" ||
+     overridden.value(overridden.find("layered")) != std::string(100, 'a' + 9999 % 26)) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // the memory-mapped loader must produce the same configuration
+  config mappedConf;
+  setAuthorizedKeys(mappedConf);
+  mappedConf.initFileMapped(conf.getFilePath());
+  config confCopy = mappedConf;
+  if(confCopy.getParamString("key_string") != "val" ||
+     confCopy.parseParamUInt("key_int") != 42 ||
+     confCopy.parseParamDouble("key_float") != 3.14159 ||
+     confCopy.parseParamUInt("key2") != 99 ||
+     confCopy.getParamString("mylist") != "{5,4,3,2,1}") {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // streaming with chunks smaller than a line visits the same pairs
+  std::string streamed;
+  size_t nbStreamed = mappedConf.streamFile(conf.getFilePath(),
+      [&](std::string_view key, std::string_view val) {
+        streamed.append(key).append("=").append(val).append(";");
+      }, 4);
+  if(nbStreamed != 5 ||
+     streamed != "key_string=val;key_int=42;key_float=3.14159;key2=99;mylist={5,4,3,2,1};") {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // later files take precedence, and a modified file is parsed again
+  std::string fragmentPath = conf.getFilePath() + ".fragment";
+  std::ofstream(fragmentPath) << "key_int = 7\nkey2 = 1\n";
+  std::vector<std::string> layers = {conf.getFilePath(), fragmentPath};
+  config layered;
+  layered.initFiles(layers);
+  // a snapshot of layers is stale once any layer changes, not just the last
+  std::string layersSnapshot = fragmentPath + ".snapshot";
+  config fragmentFirst;
+  fragmentFirst.initFiles(std::vector<std::string>({fragmentPath, conf.getFilePath()}));
+  fragmentFirst.saveSnapshot(layersSnapshot);
+  std::ofstream(fragmentPath) << "key_int = 8\n";
+  bool staleLayers = false;
+  try {
+    config stale;
+    stale.loadSnapshot(layersSnapshot);
+  } catch(snapshot_exception&) {
+    staleLayers = true;
+  }
+  remove(layersSnapshot.c_str());
+  config relayered;
+  relayered.initFiles(layers);
+  config kept;
+  kept.initFiles(layers, true);
+  remove(fragmentPath.c_str());
+  if(layered.parseParamUInt("key_int") != 7 || layered.parseParamUInt("key2") != 1 ||
+     layered.getParamString("key_string") != "val" ||
+     layered.getFilePath() != fragmentPath ||
+     relayered.parseParamUInt("key_int") != 8 || relayered.parseParamUInt("key2") != 99 ||
+     kept.parseParamUInt("key_int") != 42 || !staleLayers) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // included files are loaded in place, relative to the including file
+  std::string basePath = conf.getFilePath() + ".base";
+  std::string commonPath = conf.getFilePath() + ".common";
+  std::ofstream(basePath) << "key_int = 1\ninclude " << conf.getFileName() << ".common\nkey2 = 3\n";
+  std::ofstream(commonPath) << "# shared\nkey_int = 2\nkey2 = 2\nkey_float = 0.5\n";
+  config included;
+  included.initFile(basePath);
+  size_t nbIncluded = included.streamFile(basePath, config::stream_callback());
+  // a snapshot is stale once any included file changes
+  std::string includedSnapshot = basePath + ".snapshot";
+  included.saveSnapshot(includedSnapshot);
+  config freshInclude;
+  freshInclude.loadSnapshot(includedSnapshot);
+  // a cycle is reported at the directive that closes it
+  std::ofstream(commonPath, std::ios::app) << "include " << conf.getFileName() << ".base\n";
+  bool staleInclude = false;
+  try {
+    config stale;
+    stale.loadSnapshot(includedSnapshot);
+  } catch(snapshot_exception&) {
+    staleInclude = true;
+  }
+  remove(includedSnapshot.c_str());
+  std::string cycleLocation;
+  try {
+    config cyclic;
+    cyclic.initFileMapped(basePath);
+  } catch(syntax_exception& e) {
+    cycleLocation = e.location();
+  }
+  std::ofstream(commonPath) << "key_int = 2\nnot a pair\n";
+  std::string syntaxLocation;
+  try {
+    config invalid;
+    invalid.initFile(basePath);
+  } catch(syntax_exception& e) {
+    syntaxLocation = e.location();
+  }
+  remove(basePath.c_str());
+  remove(commonPath.c_str());
+  if(included.parseParamUInt("key_int") != 2 || included.parseParamUInt("key2") != 3 ||
+     included.parseParamDouble("key_float") != 0.5 || nbIncluded != 5 ||
+     cycleLocation != commonPath + ":5" || syntaxLocation != commonPath + ":2" ||
+     freshInclude.parseParamDouble("key_float") != 0.5 || !staleInclude) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // array references are relative to the file they were read from, also
+  // in a snapshot or a frozen configuration
+  std::string subDir = conf.getFilePath() + ".sub";
+  mkdir(subDir.c_str(), 0755);
+  std::string subArrayPath = subDir + "/data.f64";
+  arrayFile = fopen(subArrayPath.c_str(), "wb");
+  fwrite(weights, sizeof(double), 3, arrayFile);
+  fclose(arrayFile);
+  std::ofstream(subDir + "/inc.cfg") << "weights = @file:data.f64\n";
+  std::ofstream(basePath) << "include " << conf.getFileName() << ".sub/inc.cfg\n";
+  config subIncluded;
+  subIncluded.initFile(basePath);
+  array_view<double> subWeights = subIncluded.getDoubleArray("weights");
+  subIncluded.saveSnapshot(includedSnapshot);
+  config subSnapshot;
+  subSnapshot.loadSnapshot(includedSnapshot);
+  std::vector<double> subSnapshotWeights = subSnapshot.getDoubleList("weights");
+  array_view<double> subFrozenWeights = subIncluded.freeze()->getDoubleList("weights");
+  remove(includedSnapshot.c_str());
+  remove(basePath.c_str());
+  remove((subDir + "/inc.cfg").c_str());
+  remove(subArrayPath.c_str());
+  rmdir(subDir.c_str());
+  if(subWeights.size() != 3 || subWeights[1] != -2 ||
+     subSnapshotWeights != subWeights.vector() || subFrozenWeights.vector() != subWeights.vector()) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // a snapshot restores the configuration without parsing it again
+  std::string snapshotPath = conf.getFilePath() + ".snapshot";
+  mappedConf.saveSnapshot(snapshotPath);
+  config snapshotConf;
+  setAuthorizedKeys(snapshotConf);
+  snapshotConf.loadSnapshot(snapshotPath);
+  remove(snapshotPath.c_str());
+  if(snapshotConf.getFilePath() != conf.getFilePath() ||
+     snapshotConf.parseParamDouble("key_float") != 3.14159 ||
+     snapshotConf.getIntList("mylist") != mylist) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // sequences are lazy ranges, computed in closed form
+  config seqConf;
+  seqConf.addConfElem("sweep", "0:0.000001:1");
+  seqConf.addConfElem("steps", "2:3:11");
+  seq_range<double> sweepRange = seqConf.getDoubleRange("sweep");
+  std::vector<uint> steps;
+  // sub-ranges must lie within the range
+  int nbInvalidShards = 0;
+  for(size_t shardIndex : {size_t(0), size_t(8)}) {
+    try {
+      sweepRange.shard(shardIndex, shardIndex);
+    } catch(std::invalid_argument&) {
+      nbInvalidShards++;
+    }
+  }
+  try {
+    sweepRange.slice(1000000, 2);
+  } catch(std::invalid_argument&) {
+    nbInvalidShards++;
+  }
+  if(sweepRange.size() != 1000001 || sweepRange[500000] != 0.5 || sweepRange.back() != 1 ||
+     sweepRange.shard(7, 8).size() != 125000 || sweepRange.shard(7, 8).back() != 1 ||
+     !seqConf.sequenceParser("steps", steps) || steps.size() != 4 || steps[3] != 11 ||
+     seqConf.getUIntRange("steps").slice(1, 2).vector() != std::vector<uint>({5, 8}) ||
+     nbInvalidShards != 3) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // a sweep maps an index to a point of the cartesian product of its keys
+  seqConf.addConfElem("codes", "{a, b, c}");
+  seqConf.addConfElem("base", "7");
+  std::vector<std::string> axes = {"codes", "steps"};
+  sweep sw(seqConf, axes);
+  sweep::point pt = sw.at(6);
+  bool noWorkerRejected = false;
+  try {
+    sw.stridedShard(0, 0);
+  } catch(std::invalid_argument&) {
+    noWorkerRejected = true;
+  }
+  // values of an axis that are not unsigned integers are rejected
+  seqConf.addConfElem("offsets", "{-1, 0, 2}");
+  seqConf.addConfElem("halves", "0:0.5:2");
+  std::vector<std::string> offsetAxes = {"offsets", "halves"};
+  sweep offsetSweep(seqConf, offsetAxes);
+  int nbInvalidUInts = 0;
+  for(size_t i=0; i<offsetSweep.size(); i++) {
+    for(const char* k : {"offsets", "halves"}) {
+      try {
+        offsetSweep[i].parseParamUInt(k);
+      } catch(syntax_exception&) {
+        nbInvalidUInts++;
+      }
+    }
+  }
+  // strided shards of a huge sweep do not overflow
+  seqConf.addConfElem("wide", "0:1:4294967294");
+  seqConf.addConfElem("wide2", "0:1:4294967294");
+  std::vector<std::string> wideAxes = {"wide", "wide2"};
+  sweep wideSweep(seqConf, wideAxes);
+  size_t wideStride = size_t(1) << 40;
+  seq_range<size_t> wideShard = wideSweep.stridedShard(5, wideStride);
+  if(nbInvalidUInts != 5 + 3*2 || offsetSweep[7].parseParamUInt("halves") != 1 ||
+     offsetSweep[14].parseParamUInt("offsets") != 2 ||
+     wideShard.size() != (wideSweep.size() - 6) / wideStride + 1 ||
+     wideShard.back() >= wideSweep.size() || wideSweep.size() - wideShard.back() > wideStride) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+  if(sw.size() != 12 || pt.getParamString("codes") != "b" ||
+     pt.parseParamUInt("steps") != 8 || pt.getParamString("steps") != "8" ||
+     pt.parseParamUInt("base") != 7 || sw.shard(1, 5).front() != 3 ||
+     sw.shard(1, 5).size() != 3 || sw.stridedShard(1, 5).size() != 3 ||
+     !noWorkerRejected ||
+     sw.stridedShard(1, 5)[2] != 11) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // a frozen configuration holds the same values, already parsed
+  std::shared_ptr<const frozen_config> frozen = conf.freeze();
+  if(frozen->getParamString("key_string") != "val" ||
+     frozen->parseParamUInt(intHandle) != 42 ||
+     frozen->parseParamDouble("key_float") != 3.14159 ||
+     frozen->getIntList("mylist").vector() != mylist ||
+     frozen->getStringList("mylist").size() != 5 ||
+     frozen->getStringList("mylist")[4] != "1" ||
+     frozen->getFilePath() != conf.getFilePath()) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // a frozen configuration published in shared memory is read in
+  // place by the processes that attach to it
+  std::string shmName = "/config_test1_" + std::to_string(getpid());
+  frozen->publish(shmName);
+  std::shared_ptr<const frozen_config> shared = frozen_config::attach(shmName);
+  frozen_config::unpublish(shmName);
+  bool attachFailed = false;
+  try {
+    frozen_config::attach(shmName);
+  } catch(file_exception&) {
+    attachFailed = true;
+  }
+  if(shared->getParamString("key_string") != "val" ||
+     shared->parseParamUInt(intHandle) != 42 ||
+     shared->getIntList("mylist").vector() != mylist ||
+     shared->getStringList("mylist")[4] != "1" ||
+     shared->getFilePath() != conf.getFilePath() || !attachFailed) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // a diff lists the keys added, removed and changed between two
+  // configurations
+  config modified = conf;
+  modified.addConfElem("new_key", "1");
+  char* overrideArgv[] = { argv[0], const_cast<char*>("key_float=1.5") };
+  modified.initCL(2, overrideArgv);
+  config_diff confDiff(conf, modified);
+  if(confDiff.added() != std::vector<std::string>({"new_key"}) ||
+     confDiff.changed() != std::vector<std::string>({"key_float"}) ||
+     !confDiff.removed().empty() || !confDiff.affects("key_") || confDiff.affects("mylist") ||
+     confDiff.filter("new").added().size() != 1 || !config_diff(conf, conf).empty()) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // a reloader publishes each new version of the file, and keeps the
+  // current version when the file cannot be loaded
+  std::string reloadPath = conf.getFilePath() + ".reload";
+  std::ofstream(reloadPath.c_str()) << "key_int = 1\n";
+  config_reloader reloader(reloadPath, setAuthorizedKeys);
+  config_reloader::reader reader(reloader);
+  std::shared_ptr<const config> firstVersion = reloader.current();
+  std::vector<std::string> changedKeys;
+  int otherCalls = 0;
+  // a failing subscriber is reported, and does not skip the others
+  reloader.subscribe("key", [](const config_diff&, const std::shared_ptr<const config>&) {
+      throw std::runtime_error("boom");
+    });
+  reloader.subscribe("key", [&](const config_diff& diff, const std::shared_ptr<const config>&) {
+      changedKeys = diff.changed();
+      changedKeys.insert(changedKeys.end(), diff.added().begin(), diff.added().end());
+    });
+  reloader.subscribe("mylist", [&](const config_diff&, const std::shared_ptr<const config>&) {
+      otherCalls++;
+    });
+  std::ofstream(reloadPath.c_str()) << "key_int = 2\nkey2 = 5\n";
+  bool reloaded = reloader.reload();
+  uint newValue = reader.get().parseParamUInt("key_int");
+  std::string subscriberError = reloader.lastError();
+  std::ofstream(reloadPath.c_str()) << "bad_key = 3\n";
+  bool badReloaded = reloader.reload();
+  remove(reloadPath.c_str());
+  if(!reloaded || newValue != 2 || firstVersion->parseParamUInt("key_int") != 1 ||
+     badReloaded || reloader.lastError().empty() || reloader.generation() != 2 ||
+     reader.get().parseParamUInt("key_int") != 2 || otherCalls != 0 ||
+     changedKeys != std::vector<std::string>({"key_int", "key2"}) ||
+     subscriberError != "subscriber failed: boom") {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // versions published by the watching thread and by concurrent
+  // reload() calls are notified one at a time, in order, and a callback
+  // calling reload() does not recurse
+  std::string watchedPath = conf.getFilePath() + ".watched";
+  std::string watchedTmp = watchedPath + ".tmp";
+  std::ofstream(watchedPath.c_str()) << "key_int = 10\n";
+  config_reloader watched(watchedPath, setAuthorizedKeys);
+  std::atomic<int> activeCallbacks(0);
+  std::atomic<uint> lastNotified(10);
+  std::atomic<bool> overlapping(false), outOfOrder(false), reentered(false);
+  watched.subscribe("", [&](const config_diff&, const std::shared_ptr<const config>& current) {
+      if(activeCallbacks.fetch_add(1) != 0) overlapping = true;
+      uint value = current->parseParamUInt("key_int");
+      if(value <= lastNotified) outOfOrder = true;
+      lastNotified = value;
+      if(!reentered.exchange(true)) watched.reload();
+      activeCallbacks.fetch_sub(1);
+    });
+  watched.start();
+  std::thread reloading([&]() {
+      for(int i=0; i<50; i++) watched.reload();
+    });
+  for(uint value=11; value<=31; value++) {
+    if(value == 31) reloading.join();
+    // replaced atomically, so that a reload never reads a partial file
+    std::ofstream(watchedTmp.c_str()) << "key_int = " << value << "\n";
+    rename(watchedTmp.c_str(), watchedPath.c_str());
+    usleep(2000);
+  }
+  // the last version is only published by the watching thread
+  for(int i=0; i<500 && lastNotified != 31; i++) usleep(10000);
+  watched.stop();
+  if(overlapping || outOfOrder || !reentered || lastNotified != 31 ||
+     watched.current()->parseParamUInt("key_int") != 31) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // the diffs delivered to a subscriber chain together: each one is
+  // relative to the version it received last, even with concurrent reloads
+  std::shared_ptr<const config> received = watched.current();
+  int nbDiffs = 0;
+  bool unchained = false;
+  watched.subscribe("key2", [&](const config_diff& diff, const std::shared_ptr<const config>& current) {
+      config_diff expected = config_diff(*received, *current).filter("key2");
+      if(diff.added() != expected.added() || diff.removed() != expected.removed() ||
+         diff.changed() != expected.changed()) unchained = true;
+      received = current;
+      nbDiffs++;
+    });
+  std::thread reloading1([&]() { for(int i=0; i<50; i++) watched.reload(); });
+  std::thread reloading2([&]() { for(int i=0; i<50; i++) watched.reload(); });
+  for(uint value=32; value<=52; value++) {
+    std::ofstream(watchedTmp.c_str()) << "key_int = " << value << "\n"
+                                      << (value % 3 ? "key2 = " : "# ") << value << "\n";
+    rename(watchedTmp.c_str(), watchedPath.c_str());
+    usleep(2000);
+  }
+  reloading1.join();
+  reloading2.join();
+  watched.reload();
+  remove(watchedPath.c_str());
+  if(unchained || nbDiffs == 0 ||
+     !config_diff(*received, *watched.current()).filter("key2").empty()) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // command-line elements can be read from response files, which can
+  // refer to other response files
+  std::string responsePath = conf.getFilePath() + ".args";
+  std::string nestedPath = conf.getFilePath() + ".args2";
+  std::ofstream(responsePath.c_str()) << "# overrides\nkey_int=7\n\n@"
+                                      << conf.getFileName() << ".args2\n--verbose\n";
+  std::ofstream(nestedPath.c_str()) << "key2 = 12\nbad_key=1\n";
+  std::string responseArg = "@" + responsePath;
+  char* responseArgv[] = { argv[0], const_cast<char*>("key_float=1.5"),
+                           const_cast<char*>(responseArg.c_str()) };
+  config responseConf;
+  responseConf.initCL(3, responseArgv);
+  config checkedConf;
+  setAuthorizedKeys(checkedConf);
+  std::string responseError;
+  try {
+    checkedConf.initCL(3, responseArgv);
+  } catch(invalidkey_exception& e) {
+    responseError = e.location();
+  }
+  remove(responsePath.c_str());
+  remove(nestedPath.c_str());
+  if(responseConf.parseParamUInt("key_int") != 7 || responseConf.parseParamUInt("key2") != 12 ||
+     responseConf.parseParamDouble("key_float") != 1.5 || !responseConf.checkOption("verbose") ||
+     responseError != nestedPath + ":2") {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // references to other keys and to the environment are expanded once,
+  // and a copy of the unexpanded configuration gives another variant
+  config templ;
+  templ.addConfElem("dir", "${root}/${name}");
+  templ.addConfElem("root", "${env:CONFIG_TEST_ROOT}");
+  templ.addConfElem("name", "run");
+  templ.addConfElem("codes", "{${name}, $${name}}");
+  setenv("CONFIG_TEST_ROOT", "/data", 1);
+  config variant = templ;
+  size_t nbExpanded = templ.interpolate();
+  variant.initFile(conf.getFilePath());
+  variant.addConfElem("name_ref", "${key_string}");
+  variant.interpolate();
+  // expanding again keeps the literal "${", but expands new values
+  templ.addConfElem("tag", "${name}-2");
+  size_t nbReexpanded = templ.interpolate();
+  std::string literalCode = templ.getStringList("codes")[1];
+  // a value set again is expanded, even if equal to the stored literal
+  char* literalArgv[] = { argv[0], const_cast<char*>("codes={run, ${name}}") };
+  templ.initCL(2, literalArgv);
+  size_t nbReassigned = templ.interpolate();
+  config cyclic;
+  cyclic.addConfElem("a", "x${b}");
+  cyclic.addConfElem("b", "${a}");
+  std::string cycleError;
+  try {
+    cyclic.interpolate();
+  } catch(syntax_exception& e) {
+    cycleError = e.what();
+  }
+  if(nbExpanded != 3 || templ.getParamString("dir") != "/data/run" ||
+     literalCode != "${name}" ||
+     nbReexpanded != 1 || templ.getParamString("tag") != "run-2" ||
+     nbReassigned != 1 || templ.getStringList("codes")[1] != "run" ||
+     variant.getParamString("name_ref") != "val" ||
+     cycleError != "interpolation cycle: a -> b -> a") {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // optional keys can be probed without exceptions
+  std::vector<int> noList;
+  if(conf.tryParamUInt("key_int") != 42u || conf.tryParamUInt("missing") ||
+     conf.getOr("missing", 7) != 7 || conf.getOr("key_float", 1.0) != 3.14159 ||
+     conf.getOr("missing", "dflt") != "dflt" || conf.getOr("key_string", "x") != "val" ||
+     !conf.tryIntList("mylist") || conf.tryIntList("key_string") ||
+     &conf.getOr("key_string", noList) != &noList ||
+     conf.getOr("mylist", noList) != mylist || conf.tryUIntRange("key_string") ||
+     conf.tryResolve("missing")) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // a batch reads several keys at once, and writes nothing if a
+  // required key is missing
+  std::string batchString;
+  uint batchInt = 0;
+  double batchMissing = 2.5;
+  std::vector<int> batchList;
+  bool batchOption = true;
+  size_t batchFound = conf.getParams({ {"key_string", batchString}, {"key_int", batchInt},
+                                       {"mylist", batchList},
+                                       config::binding("missing", batchMissing).optional(),
+                                       config::binding::option("verbose", batchOption) });
+  bool batchThrew = false;
+  uint untouched = 5;
+  try {
+    conf.getParams({ {"key2", untouched}, {"missing", batchMissing} });
+  } catch(key_not_found&) {
+    batchThrew = true;
+  }
+  if(batchFound != 3 || batchString != "val" || batchInt != 42 || batchList != mylist ||
+     batchMissing != 2.5 || batchOption || !batchThrew || untouched != 5) {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+  // a schema binds the whole file into a struct, and rejects values
+  // that are not entirely valid for their type
+  sample_params params = sampleSchema.load(conf.getFilePath());
+  std::string schemaPath = conf.getFilePath() + ".schema";
+  std::ofstream(schemaPath.c_str()) << "key_string = a\nkey_int = 4x\n";
+  std::string typeError;
+  try {
+    sampleSchema.load(schemaPath);
+  } catch(syntax_exception& e) {
+    typeError = e.location();
+  }
+  remove(schemaPath.c_str());
+  if(params.name != "val" || params.count != 42 || params.ratio != 3.14159 ||
+     params.other != 99 || params.values != mylist || params.verbose ||
+     typeError != schemaPath + ":2") {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+
+#ifdef CONFIG_INSTRUMENTATION
+  // every getter call is counted, and keys that are never read are reported
+  config counted;
+  counted.initFile(conf.getFilePath());
+  for(int i=0; i<3; i++) counted.parseParamUInt("key_int");
+  counted.getIntList(counted.resolve("mylist"));
+  // a cached list is only parsed once, whichever getter reads it
+  std::vector<int> countedList;
+  counted.listParser(counted.resolve("mylist"), countedList);
+  std::vector<config::key_access> hot = counted.hotKeys(2);
+  std::vector<std::string> unused = counted.unusedKeys();
+  if(hot.size() != 2 || hot[1].key != "key_int" || hot[1].totalLookups != 3 ||
+     hot[1].lookups[access_stats::PARSE_UINT] != 3 || hot[1].nbParses != 1 ||
+     hot[0].key != "mylist" || hot[0].nbParses != 1 ||
+     unused.size() != 3 || unused[0] != "key_string") {
+	  cerr<< "TEST FAILS!" <<endl;
+	  return 1;
+  }
+#endif
+
   cerr<< "TEST PASS" <<endl;
   return 0;
 }